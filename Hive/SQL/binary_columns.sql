@@ -0,0 +1,16 @@
+-- ----------------------------
+-- Binary SQF columns (BinaryColumns in HiveExt.ini)
+-- Existing text values stay readable, set BinaryMigrateBatch to convert them in the background
+-- If you use a different WSField or object Table, adjust the names below
+-- ----------------------------
+ALTER TABLE `Character_DATA`
+  MODIFY `Inventory` blob,
+  MODIFY `Backpack` blob,
+  MODIFY `Worldspace` varbinary(128) NOT NULL DEFAULT '[]',
+  MODIFY `Medical` varbinary(256) NOT NULL DEFAULT '[]',
+  MODIFY `CurrentState` varbinary(128) NOT NULL DEFAULT '[]';
+
+ALTER TABLE `Object_DATA`
+  MODIFY `Worldspace` varbinary(128) NOT NULL DEFAULT '[]',
+  MODIFY `Inventory` blob,
+  MODIFY `Hitpoints` varbinary(512) NOT NULL DEFAULT '[]';
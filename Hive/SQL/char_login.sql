@@ -0,0 +1,55 @@
+-- ----------------------------
+-- Character login in one round trip (LoginProcedure in HiveExt.ini)
+-- Returns the player (NewPlayer, PreviousName if the name changed),
+-- then the alive character, creating a new one if there isn't any
+-- If you use a different IDField or WSField, adjust the names below
+-- ----------------------------
+DROP PROCEDURE IF EXISTS `pCharacterLogin`;
+
+DELIMITER ;;
+CREATE PROCEDURE `pCharacterLogin`(IN `pPlayerUID` varchar(32), IN `pPlayerName` varchar(128) CHARACTER SET utf8, IN `pInstance` int)
+BEGIN
+  DECLARE vPreviousName varchar(128) CHARACTER SET utf8 DEFAULT NULL;
+  DECLARE vNewPlayer tinyint DEFAULT 0;
+  DECLARE vCharacterID int UNSIGNED DEFAULT NULL;
+  DECLARE vGeneration int DEFAULT 1;
+  DECLARE vHumanity int DEFAULT 2500;
+  DECLARE vModel varchar(64) DEFAULT '';
+  -- the first character of a player has no dead one before it
+  DECLARE CONTINUE HANDLER FOR NOT FOUND BEGIN END;
+
+  SET vPreviousName = (SELECT `PlayerName` FROM `Player_DATA` WHERE `PlayerUID` = pPlayerUID);
+  IF vPreviousName IS NULL THEN
+    SET vNewPlayer = 1;
+    INSERT INTO `Player_DATA` (`PlayerUID`, `PlayerName`) VALUES (pPlayerUID, pPlayerName);
+  ELSEIF BINARY vPreviousName <> BINARY pPlayerName THEN
+    UPDATE `Player_DATA` SET `PlayerName` = pPlayerName WHERE `PlayerUID` = pPlayerUID;
+  ELSE
+    SET vPreviousName = NULL;
+  END IF;
+  SELECT vNewPlayer AS `NewPlayer`, vPreviousName AS `PreviousName`;
+
+  SET vCharacterID = (SELECT `CharacterID` FROM `Character_DATA` WHERE `PlayerUID` = pPlayerUID AND `Alive` = 1 ORDER BY `CharacterID` DESC LIMIT 1);
+  IF vCharacterID IS NOT NULL THEN
+    -- survival time is counted up to the previous login, so this comes before LastLogin is changed
+    SELECT `CharacterID`, `Worldspace`, `Inventory`, `Backpack`,
+      TIMESTAMPDIFF(MINUTE,`Datestamp`,`LastLogin`) as `SurvivalTime`,
+      TIMESTAMPDIFF(MINUTE,`LastAte`,NOW()) as `MinsLastAte`,
+      TIMESTAMPDIFF(MINUTE,`LastDrank`,NOW()) as `MinsLastDrank`,
+      `Model`, 0 AS `NewCharacter`
+    FROM `Character_DATA` WHERE `CharacterID` = vCharacterID;
+    UPDATE `Character_DATA` SET `LastLogin` = CURRENT_TIMESTAMP WHERE `CharacterID` = vCharacterID;
+  ELSE
+    -- a new character carries on from the last dead one
+    SELECT `Generation`+1, `Humanity`, `Model` INTO vGeneration, vHumanity, vModel
+    FROM `Character_DATA` WHERE `PlayerUID` = pPlayerUID AND `Alive` = 0 ORDER BY `CharacterID` DESC LIMIT 1;
+
+    INSERT INTO `Character_DATA` (`PlayerUID`, `InstanceID`, `Worldspace`, `Inventory`, `Backpack`, `Medical`, `Generation`, `Datestamp`, `LastLogin`, `LastAte`, `LastDrank`, `Humanity`)
+    VALUES (pPlayerUID, pInstance, '[]', '[]', '[]', '[]', vGeneration, CURRENT_TIMESTAMP, CURRENT_TIMESTAMP, CURRENT_TIMESTAMP, CURRENT_TIMESTAMP, vHumanity);
+    SET vCharacterID = LAST_INSERT_ID();
+
+    SELECT vCharacterID AS `CharacterID`, '[]' AS `Worldspace`, '[]' AS `Inventory`, '[]' AS `Backpack`,
+      0 AS `SurvivalTime`, 0 AS `MinsLastAte`, 0 AS `MinsLastDrank`, vModel AS `Model`, 1 AS `NewCharacter`;
+  END IF;
+END;;
+DELIMITER ;
@@ -18,5 +18,17 @@ CREATE TABLE `Object_DATA` (
   `last_updated` timestamp NOT NULL DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP,
   PRIMARY KEY (`ObjectID`),
   KEY `ObjectUID` (`ObjectUID`),
-  KEY `Instance` (`Instance`)
+  KEY `Instance` (`Instance`),
+  KEY `Instance_updated` (`Instance`,`last_updated`)
 ) ENGINE=InnoDB AUTO_INCREMENT=1 DEFAULT CHARSET=latin1;
+
+-- ----------------------------
+-- Table structure for `Object_ID_SEQUENCE`
+-- ObjectID blocks handed out to HiveExt (IDBlockSize in HiveExt.ini), one row per object table
+-- ----------------------------
+CREATE TABLE `Object_ID_SEQUENCE` (
+  `TableName` varchar(64) NOT NULL,
+  `NextID` int(11) UNSIGNED NOT NULL DEFAULT '1',
+  `Owner` varchar(32) NOT NULL DEFAULT '',
+  PRIMARY KEY (`TableName`)
+) ENGINE=InnoDB DEFAULT CHARSET=latin1;
@@ -0,0 +1,7 @@
+-- ----------------------------
+-- Index for finding recently changed objects (ChangePollInterval and SnapshotFile in HiveExt.ini)
+-- Already part of obj_tables.sql, existing installs run this once
+-- If you use a different object Table, adjust the name below
+-- ----------------------------
+ALTER TABLE `Object_DATA`
+  ADD KEY `Instance_updated` (`Instance`,`last_updated`);
@@ -33,18 +33,20 @@ public:
 		DB_TYPE_BOOL    = 0x04
 	};
 
-	Field() : _value(nullptr), _type(DB_TYPE_UNKNOWN) {}
-	Field(const char* value, enum DataTypes type) : _value(value), _type(type) {}
+	Field() : _value(nullptr), _length(0), _type(DB_TYPE_UNKNOWN) {}
+	Field(const char* value, enum DataTypes type) : _value(value), _length(value ? strlen(value) : 0), _type(type) {}
 	~Field() {}
 
 	DataTypes getType() const { return _type; }
 	bool isNull() const { return _value == nullptr; }
 
 	const char* getCStr() const { return _value; }
+	//byte count of the value, valid for binary columns that contain zeroes
+	size_t getLength() const { return _length; }
 	std::string getString() const
 	{
 		//std::string s = 0 has undefined result
-		return _value ? _value : "";
+		return _value ? std::string(_value,_length) : "";
 	}
 	double getDouble() const { return _value ? static_cast<double>(atof(_value)) : 0.0; }
 	float getFloat() const { return static_cast<float>(getDouble()); }
@@ -70,8 +72,10 @@ public:
 	void setType(DataTypes type) { _type = type; }
 	//no need for memory allocations to store resultset field strings
 	//all we need is to cache pointers returned by different DBMS APIs
-	void setValue(const char* value) { _value = value; };
+	void setValue(const char* value) { _value = value; _length = value ? strlen(value) : 0; };
+	void setValue(const char* value, size_t length) { _value = value; _length = value ? length : 0; };
 private:
 	const char* _value;
+	size_t _length;
 	enum DataTypes _type;
 };
\ No newline at end of file
@@ -455,7 +455,7 @@ bool ConcreteDatabase::transactionRollback()
 	return true;
 }
 
-bool ConcreteDatabase::executeStmt( const SqlStatementID& id, SqlStmtParameters& params )
+bool ConcreteDatabase::executeStmt( const SqlStatementID& id, SqlStmtParameters& params, SqlStatement::ExecCallback onDone )
 {
 	if (!_asyncConn)
 		return false;
@@ -464,28 +464,42 @@ bool ConcreteDatabase::executeStmt( const SqlStatementID& id, SqlStmtParameters&
 	if(pTrans)
 	{
 		//add SQL request to trans queue
-		pTrans->queueOperation(new SqlPreparedRequest(id, params));
+		if (onDone.empty())
+			pTrans->queueOperation(new SqlPreparedRequest(id, params));
+		else
+			pTrans->queueOperation(new SqlPreparedRequest(id, params, onDone, _resultQueue));
 	}
 	else
 	{
 		//if async execution is not available
 		if(!_asyncAllowed)
-			return directExecuteStmt(id, params);
+		{
+			SqlExecResult result;
+			bool exRes = directExecuteStmt(id, params, &result);
+			//still goes through the queue, so the callback is always invoked the same way
+			if (!onDone.empty())
+				_resultQueue.push(QueryCallback([onDone,exRes,result](QueryCallback::ResType) { onDone(exRes,result); }));
+
+			return exRes;
+		}
 
 		//Simple sql statement
-		_delayRunner->queueOperation(new SqlPreparedRequest(id, params));
+		if (onDone.empty())
+			_delayRunner->queueOperation(new SqlPreparedRequest(id, params));
+		else
+			_delayRunner->queueOperation(new SqlPreparedRequest(id, params, onDone, _resultQueue));
 	}
 
 	return true;
 }
 
-bool ConcreteDatabase::directExecuteStmt( const SqlStatementID& id, SqlStmtParameters& params )
+bool ConcreteDatabase::directExecuteStmt( const SqlStatementID& id, SqlStmtParameters& params, SqlExecResult* outResult )
 {
 	//execute statement
 	SqlConnection& conn = getAsyncConnection();
 	SqlConnection::Lock guard(conn);
 
-	return Retry::SqlOp<bool>(getLogger(),[&](SqlConnection& c){ return c.executeStmt(id, params); })(conn,"DirectStmtExec",[&](){ return conn.getStmt(id)->getSqlString(true); });
+	return Retry::SqlOp<bool>(getLogger(),[&](SqlConnection& c){ return c.executeStmt(id, params, outResult); })(conn,"DirectStmtExec",[&](){ return conn.getStmt(id)->getSqlString(true); });
 }
 
 unique_ptr<SqlStatement> ConcreteDatabase::makeStatement( SqlStatementID& index, std::string sqlText )
@@ -131,8 +131,8 @@ protected:
 	friend class SqlStatementImpl;
 	//PREPARED STATEMENT API
 	//query function for prepared statements
-	bool executeStmt(const SqlStatementID& id, SqlStmtParameters& params);
-	bool directExecuteStmt(const SqlStatementID& id, SqlStmtParameters& params);
+	bool executeStmt(const SqlStatementID& id, SqlStmtParameters& params, SqlStatement::ExecCallback onDone = SqlStatement::ExecCallback());
+	bool directExecuteStmt(const SqlStatementID& id, SqlStmtParameters& params, SqlExecResult* outResult = nullptr);
 
 	//connection helper counters
 	Poco::AtomicCounter _currConn;  //counter for connection selection
@@ -727,6 +727,8 @@ bool MySqlPreparedStatement::execute()
 		args = &_myArgs[0];
 
 	_mySqlConn._MySQLStmtExecute(*this, _myStmt);
+	_lastResult.affectedRows = mysql_stmt_affected_rows(_myStmt);
+	_lastResult.insertId = mysql_stmt_insert_id(_myStmt);
 
 	return true;
 }
@@ -49,9 +49,10 @@ bool QueryResultMySql::fetchRow()
 	if (!myRow) //no more rows in this result set
 		return false;
 
-	//we got a row, point the pointers
+	//we got a row, point the pointers (with lengths, binary columns can contain zeroes)
+	const unsigned long* lengths = mysql_fetch_lengths(theRes.myRes);
 	for (size_t i=0; i<_row.size(); i++)
-		_row[i].setValue(myRow[i]);
+		_row[i].setValue(myRow[i],lengths[i]);
 
 	return true;
 }
@@ -172,7 +172,7 @@ bool QueryResultPostgre::fetchRow()
 		if (PQgetisnull(theRes.pgRes,static_cast<int>(_tblIdx),static_cast<int>(fieldNum)))
 			strValue = nullptr; //nullify if the actual field is NULL
 
-		_row[fieldNum].setValue(strValue);
+		_row[fieldNum].setValue(strValue,PQgetlength(theRes.pgRes,static_cast<int>(_tblIdx),static_cast<int>(fieldNum)));
 	}
 	_tblIdx++;
 
@@ -92,7 +92,7 @@ SqlPreparedStatement* SqlConnection::getStmt( const SqlStatementID& stId )
 	return pStmt;
 }
 
-bool SqlConnection::executeStmt( const SqlStatementID& stId, const SqlStmtParameters& params )
+bool SqlConnection::executeStmt( const SqlStatementID& stId, const SqlStmtParameters& params, SqlExecResult* outResult )
 {
 	if(!stId.isInitialized())
 		return false;
@@ -102,7 +102,14 @@ bool SqlConnection::executeStmt( const SqlStatementID& stId, const SqlStmtParame
 	//bind parameters
 	pStmt->bind(params);
 	//execute statement
-	try { return pStmt->execute(); }
+	try 
+	{ 
+		bool exRes = pStmt->execute();
+		if (outResult != nullptr)
+			*outResult = pStmt->lastResult();
+
+		return exRes;
+	}
 	catch(const SqlException& e)
 	{
 		if (e.isConnLost() || e.isRepeatable())
@@ -32,6 +32,7 @@ class QueryResult;
 class QueryNamedResult;
 class SqlStatementID;
 class SqlStmtParameters;
+struct SqlExecResult;
 
 class SqlConnection : public boost::noncopyable
 {
@@ -82,7 +83,7 @@ public:
 	virtual bool transactionRollback();
 
 	//methods to work with prepared statements
-	bool executeStmt(const SqlStatementID& stId, const SqlStmtParameters& id);
+	bool executeStmt(const SqlStatementID& stId, const SqlStmtParameters& id, SqlExecResult* outResult = nullptr);
 
 	//SqlConnection object lock
 	class Lock
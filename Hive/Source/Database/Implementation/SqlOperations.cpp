@@ -113,8 +113,28 @@ bool SqlTransaction::rawExecute(SqlConnection& sqlConn, bool throwExc)
 
 bool SqlPreparedRequest::rawExecute(SqlConnection& sqlConn, bool throwExc)
 {
-	return Retry::SqlOp<bool>(sqlConn.getDB().getLogger(),[&](SqlConnection& c){ return c.executeStmt(_id, _params); }, throwExc)
+	bool success = Retry::SqlOp<bool>(sqlConn.getDB().getLogger(),[&](SqlConnection& c){ return c.executeStmt(_id, _params, &_result); }, throwExc)
 		(sqlConn,"PreparedRequest",[&](){ return sqlConn.getStmt(_id)->getSqlString(true); });
+
+	//as part of a transaction, the callback has to wait for the commit
+	if (_queue && !throwExc)
+		_queue->push(resultCallback(success));
+
+	return success;
+}
+
+void SqlPreparedRequest::transExecute( SqlConnection& sqlConn, SuccessCallback& transSuccess )
+{
+	SqlOperation::transExecute(sqlConn,transSuccess);
+	if (_queue)
+		transSuccess = [&]() { _queue->push(resultCallback(true)); };
+}
+
+QueryCallback SqlPreparedRequest::resultCallback( bool success ) const
+{
+	SqlStatement::ExecCallback onDone = _onDone;
+	SqlExecResult result = _result;
+	return QueryCallback([onDone,success,result](QueryCallback::ResType) { onDone(success,result); });
 }
 
 // ---- ASYNC QUERIES ----
@@ -31,6 +31,7 @@ class Database;
 class SqlConnection;
 class SqlDelayThread;
 class SqlStmtParameters;
+class SqlResultQueue;
 
 class SqlOperation
 {
@@ -80,13 +81,23 @@ private:
 class SqlPreparedRequest : public SqlOperation
 {
 public:
-	SqlPreparedRequest(const SqlStatementID& stId, SqlStmtParameters& arg) : _id(stId) { _params.swap(arg); }
+	SqlPreparedRequest(const SqlStatementID& stId, SqlStmtParameters& arg) : _id(stId), _queue(nullptr) { _params.swap(arg); }
+	//onDone goes to the result queue once the statement has been executed
+	SqlPreparedRequest(const SqlStatementID& stId, SqlStmtParameters& arg, SqlStatement::ExecCallback onDone, SqlResultQueue& queue) 
+		: _id(stId), _onDone(onDone), _queue(&queue) { _params.swap(arg); }
 	~SqlPreparedRequest() {}
 protected:
 	bool rawExecute(SqlConnection& sqlConn, bool throwExc) override;
+	void transExecute(SqlConnection& sqlConn, SuccessCallback& transSuccess) override;
 private:
+	QueryCallback resultCallback(bool success) const;
+
 	SqlStatementID _id;
 	SqlStmtParameters _params;
+
+	SqlStatement::ExecCallback _onDone;
+	SqlResultQueue* _queue;
+	SqlExecResult _result;
 };
 
 // ---- ASYNC QUERIES ----
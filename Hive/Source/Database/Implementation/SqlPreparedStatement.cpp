@@ -74,6 +74,8 @@ void SqlPlainPreparedStatement::bind( const SqlStmtParameters& holder )
 bool SqlPlainPreparedStatement::execute()
 {
 	poco_assert(isPrepared());
+	//plain queries don't report anything back
+	_lastResult = SqlExecResult();
 
 	if (_preparedSql.empty())
 		return false;
@@ -19,6 +19,7 @@
 #pragma once
 
 #include "Shared/Common/Types.h"
+#include "Database/SqlStatement.h"
 
 class SqlConnection;
 class SqlStmtField;
@@ -44,6 +45,8 @@ public:
 
 	//execute statement w/o result set
 	virtual bool execute() = 0;
+	//what the last execute did
+	const SqlExecResult& lastResult() const { return _lastResult; }
 
 	virtual int lastError() const { return 0; }
 	virtual std::string lastErrorDescr() const { return ""; }
@@ -64,6 +67,8 @@ protected:
 	bool _isQuery;
 	bool _prepared;
 
+	SqlExecResult _lastResult;
+
 	const char* _stmtSql;
 	size_t _stmtLen;
 
@@ -46,4 +46,18 @@ bool SqlStatementImpl::directExecute()
 	SqlStmtParameters args = detach();
 	verifyNumBoundParams(args);
 	return _dbEngine->directExecuteStmt(_stmtId, args);
+}
+
+bool SqlStatementImpl::execute( ExecCallback onDone )
+{
+	SqlStmtParameters args = detach();
+	verifyNumBoundParams(args);
+	return _dbEngine->executeStmt(_stmtId, args, onDone);
+}
+
+bool SqlStatementImpl::directExecute( SqlExecResult& result )
+{
+	SqlStmtParameters args = detach();
+	verifyNumBoundParams(args);
+	return _dbEngine->directExecuteStmt(_stmtId, args, &result);
 }
\ No newline at end of file
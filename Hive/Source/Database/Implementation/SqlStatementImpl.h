@@ -54,8 +54,10 @@ public:
 
 		return *this;
 	}
-	bool execute();
-	bool directExecute();
+	bool execute() override;
+	bool directExecute() override;
+	bool execute(ExecCallback onDone) override;
+	bool directExecute(SqlExecResult& result) override;
 protected:
 	//don't allow anyone except Database class to create static SqlStatement objects
 	friend class ConcreteDatabase;
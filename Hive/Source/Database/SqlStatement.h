@@ -21,6 +21,7 @@
 #include "Shared/Common/Types.h"
 #include "Shared/Common/Exception.h"
 #include <boost/variant.hpp>
+#include <boost/function.hpp>
 #include <sstream>
 
 class SqlStmtField
@@ -256,6 +257,16 @@ private:
 	size_t _numArgs;
 };
 
+//what executing a statement did, zeroes if the database can't tell
+struct SqlExecResult
+{
+	SqlExecResult() : affectedRows(0), insertId(0) {}
+
+	UInt64 affectedRows;
+	//AUTO_INCREMENT value generated by an INSERT
+	UInt64 insertId;
+};
+
 //statement index
 class SqlStatement
 {
@@ -268,6 +279,12 @@ public:
 	virtual bool execute() = 0;
 	virtual bool directExecute() = 0;
 
+	//called with whether the statement succeeded and what it did
+	typedef boost::function<void(bool,const SqlExecResult&)> ExecCallback;
+	//the callback is invoked by Database::invokeCallbacks, like the ones of async queries
+	virtual bool execute(ExecCallback onDone) = 0;
+	virtual bool directExecute(SqlExecResult& result) = 0;
+
 	//templates to simplify 1-5 parameter bindings
 	template<typename ParamType1>
 	bool executeParams(ParamType1 param1)
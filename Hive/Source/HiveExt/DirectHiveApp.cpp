@@ -18,11 +18,19 @@
 
 #include "DirectHiveApp.h"
 
-DirectHiveApp::DirectHiveApp(string suffixDir) : HiveExtApp(suffixDir) {}
-
 #include "Shared/Library/Database/DatabaseLoader.h"
 #include "HiveLib/DataSource/SqlCharDataSource.h"
 #include "HiveLib/DataSource/SqlObjDataSource.h"
+#include "HiveLib/DataSource/SqlBinaryMigrator.h"
+
+DirectHiveApp::DirectHiveApp(string suffixDir) : HiveExtApp(suffixDir) {}
+
+//migrators and the object preload have to stop before the datasources and databases go away
+DirectHiveApp::~DirectHiveApp() 
+{ 
+	_migrators.clear(); 
+	finishObjectPreload();
+}
 
 bool DirectHiveApp::initialiseService()
 {
@@ -54,19 +62,77 @@ bool DirectHiveApp::initialiseService()
 		}
 	}
 
+	SqlDataSource::Precision precision;
+	{
+		Poco::AutoPtr<Poco::Util::AbstractConfiguration> numConf(config().createView("Numbers"));
+		precision.worldspace = numConf->getInt("Worldspace",-1);
+		precision.hitpoints = numConf->getInt("Hitpoints",-1);
+		precision.damage = numConf->getInt("Damage",-1);
+		precision.fuel = numConf->getInt("Fuel",-1);
+	}
+
 	//Create character datasource
 	{
 		static const string defaultID = "PlayerUID";
 		static const string defaultWS = "Worldspace";
 
 		Poco::AutoPtr<Poco::Util::AbstractConfiguration> charDBConf(config().createView("Characters"));
-		_charData.reset(new SqlCharDataSource(logger(),_charDb,charDBConf->getString("IDField",defaultID),charDBConf->getString("WSField",defaultWS)));	
+		const string wsField = charDBConf->getString("WSField",defaultWS);
+		SqlCharDataSource* charData = new SqlCharDataSource(logger(),_charDb,charDBConf->getString("IDField",defaultID),wsField);
+		_charData.reset(charData);
+		charData->setPrecision(precision);
+		charData->setSkipUnchanged(charDBConf->getBool("SkipUnchangedWrites",false));
+		charData->setLoginProcedure(charDBConf->getString("LoginProcedure",""));
+		charData->setCache(std::max(charDBConf->getInt("CacheSize",0),0),charDBConf->getInt("CacheTTL",600));
+		charData->prewarmCache(charDBConf->getInt("CachePrewarmHours",0));
+		charData->setWriteInterval(charDBConf->getInt("WriteInterval",0));
+
+		if (charDBConf->getBool("BinaryColumns",false))
+		{
+			const bool compress = charDBConf->getBool("BinaryCompression",true);
+			charData->setBinaryColumns(true,compress);
+
+			int batchSize = charDBConf->getInt("BinaryMigrateBatch",0);
+			if (batchSize > 0)
+			{
+				vector<string> fields;
+				fields.push_back(wsField);
+				fields.push_back("Inventory");
+				fields.push_back("Backpack");
+				fields.push_back("Medical");
+				fields.push_back("CurrentState");
+				_migrators.push_back(shared_ptr<SqlBinaryMigrator>(new SqlBinaryMigrator(logger(),_charDb,"Character_DATA","CharacterID",fields,batchSize,compress)));
+			}
+		}
 	}
 
 	//Create object datasource
+	int preloadInstance = -1;
 	{
 		Poco::AutoPtr<Poco::Util::AbstractConfiguration> objConf(config().createView("Objects"));
-		_objData.reset(new SqlObjDataSource(logger(),_objDb,objConf.get()));
+		SqlObjDataSource* objData = new SqlObjDataSource(logger(),_objDb,objConf.get());
+		preloadInstance = objConf->getInt("PreloadInstance",-1);
+		if (objConf->getBool("MemoryStore",false))
+			_objectStore.reset(new ObjectStore(objConf->getDouble("StoreCellSize",100)));
+		_objData.reset(objData);
+		objData->setPrecision(precision);
+
+		if (objConf->getBool("BinaryColumns",false))
+		{
+			const bool compress = objConf->getBool("BinaryCompression",true);
+			objData->setBinaryColumns(true,compress);
+
+			int batchSize = objConf->getInt("BinaryMigrateBatch",0);
+			if (batchSize > 0)
+			{
+				vector<string> fields;
+				fields.push_back("Worldspace");
+				fields.push_back("Inventory");
+				fields.push_back("Hitpoints");
+				_migrators.push_back(shared_ptr<SqlBinaryMigrator>(new SqlBinaryMigrator(logger(),_objDb,
+					_objDb->escape(objConf->getString("Table","Object_DATA")),"ObjectID",fields,batchSize,compress)));
+			}
+		}
 	}
 
 	//Create custom datasource
@@ -75,6 +141,12 @@ bool DirectHiveApp::initialiseService()
 	_charDb->allowAsyncOperations();	
 	if (_objDb != _charDb)
 		_objDb->allowAsyncOperations();
+
+	for (auto it=_migrators.begin();it!=_migrators.end();++it)
+		(*it)->start();
+
+	if (preloadInstance >= 0)
+		startObjectPreload(preloadInstance,_objDb.get());
 	
 	return true;
 }
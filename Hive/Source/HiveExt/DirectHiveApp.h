@@ -22,12 +22,15 @@
 #include "HiveLib/HiveExtApp.h"
 
 class Database;
+class SqlBinaryMigrator;
 class DirectHiveApp: public HiveExtApp
 {
 public:
 	DirectHiveApp(string suffixDir);
+	~DirectHiveApp();
 protected:
 	bool initialiseService() override;
 private:
 	shared_ptr<Database> _charDb, _objDb;
+	vector<shared_ptr<SqlBinaryMigrator>> _migrators;
 };
\ No newline at end of file
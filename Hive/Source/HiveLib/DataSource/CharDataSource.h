@@ -32,6 +32,8 @@ public:
 	virtual bool initCharacter( int characterId, const Sqf::Value& inventory, const Sqf::Value& backpack ) = 0;
 	virtual bool killCharacter( int characterId, int duration ) = 0;
 	virtual bool recordLogin( string playerId, int characterId, int action ) = 0;
+	//writes out any character updates that are being held back
+	virtual void flushWrites() {}
 protected:
 	static int SanitiseInv(Sqf::Parameters& origInv);
 };
\ No newline at end of file
@@ -0,0 +1,192 @@
+/*
+* Copyright (C) 2009-2013 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "CharacterCache.h"
+#include "Shared/Common/Timer.h"
+
+#include <Poco/Logger.h>
+
+#include <boost/lexical_cast.hpp>
+using boost::lexical_cast;
+
+namespace
+{
+	const UInt64 SUMMARY_EVERY = 1000;
+};
+
+CharacterCache::CharacterCache( Poco::Logger& logger, size_t maxEntries, int ttlSeconds )
+	: _logger(logger), _maxEntries(maxEntries), _ttlSeconds(ttlSeconds), _numHits(0), _numMisses(0)
+{
+}
+
+CharacterCache::~CharacterCache() {}
+
+bool CharacterCache::findByPlayer( const string& playerId, Character& out )
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	auto playerIt = _byPlayer.find(playerId);
+	auto it = (playerIt != _byPlayer.end()) ? lookup(playerIt->second) : _entries.end();
+	countLookup(it != _entries.end());
+	if (it == _entries.end())
+		return false;
+
+	out = it->character;
+	return true;
+}
+
+bool CharacterCache::find( int characterId, Character& out )
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	auto it = lookup(characterId);
+	countLookup(it != _entries.end());
+	if (it == _entries.end())
+		return false;
+
+	out = it->character;
+	return true;
+}
+
+bool CharacterCache::change( int characterId, const ChangeFunc& func )
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	auto loadIt = _loading.find(characterId);
+	if (loadIt != _loading.end())
+		loadIt->second = true;
+
+	auto idIt = _byId.find(characterId);
+	if (idIt == _byId.end())
+		return false;
+
+	func(idIt->second->character);
+	return true;
+}
+
+void CharacterCache::remove( int characterId )
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	auto loadIt = _loading.find(characterId);
+	if (loadIt != _loading.end())
+		loadIt->second = true;
+
+	auto idIt = _byId.find(characterId);
+	if (idIt != _byId.end())
+		erase(idIt->second);
+}
+
+void CharacterCache::loading( int characterId )
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+	_loading[characterId] = false;
+}
+
+void CharacterCache::loaded( const Character& character )
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	auto loadIt = _loading.find(character.characterId);
+	if (loadIt != _loading.end())
+	{
+		bool outdated = loadIt->second;
+		_loading.erase(loadIt);
+		if (outdated)
+			return;
+	}
+
+	insert(character);
+}
+
+bool CharacterCache::prewarmed( const Character& character )
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	//never pushes out characters that were actually used either
+	if (_loading.count(character.characterId) || _byId.count(character.characterId) || _entries.size() >= _maxEntries)
+		return false;
+
+	insert(character);
+	return true;
+}
+
+void CharacterCache::loadFailed( int characterId )
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+	_loading.erase(characterId);
+}
+
+void CharacterCache::insert( const Character& character )
+{
+	auto idIt = _byId.find(character.characterId);
+	if (idIt != _byId.end())
+		erase(idIt->second);
+
+	Entry entry;
+	entry.character = character;
+	entry.loadedAt = GlobalTimer::getTime();
+	_entries.push_front(entry);
+	_byId[character.characterId] = _entries.begin();
+	_byPlayer[character.playerId] = character.characterId;
+
+	while (_entries.size() > _maxEntries)
+		erase(--_entries.end());
+}
+
+CharacterCache::EntryList::iterator CharacterCache::lookup( int characterId )
+{
+	auto idIt = _byId.find(characterId);
+	if (idIt == _byId.end())
+		return _entries.end();
+
+	auto it = idIt->second;
+	if (GlobalTimer::getTime() - it->loadedAt >= _ttlSeconds)
+	{
+		erase(it);
+		return _entries.end();
+	}
+
+	_entries.splice(_entries.begin(),_entries,it);
+	return it;
+}
+
+void CharacterCache::erase( EntryList::iterator it )
+{
+	const Character& character = it->character;
+	auto playerIt = _byPlayer.find(character.playerId);
+	if (playerIt != _byPlayer.end() && playerIt->second == character.characterId)
+		_byPlayer.erase(playerIt);
+
+	_byId.erase(character.characterId);
+	_entries.erase(it);
+}
+
+void CharacterCache::countLookup( bool hit )
+{
+	if (hit)
+		_numHits++;
+	else
+		_numMisses++;
+
+	if ((_numHits + _numMisses) % SUMMARY_EVERY == 0)
+	{
+		_logger.information("Character cache: " + lexical_cast<string>(_numHits) + " hits, " + lexical_cast<string>(_numMisses) + " misses, " + 
+			lexical_cast<string>(_entries.size()) + " characters cached");
+	}
+}
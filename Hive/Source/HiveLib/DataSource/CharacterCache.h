@@ -0,0 +1,118 @@
+/*
+* Copyright (C) 2009-2013 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "DataSource.h"
+
+#include <boost/function.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
+#include <Poco/Mutex.h>
+
+#include <list>
+
+namespace Poco { class Logger; };
+
+//recently used characters kept in memory, so logins and detail loads of players that were just around don't need the database.
+//entries are dropped when they get older than the TTL (counted from when they were loaded) or when there are too many
+class CharacterCache
+{
+public:
+	//times are unix seconds
+	struct Character
+	{
+		Character() : characterId(-1), generation(1), killsZ(0), headshotsZ(0), killsH(0), killsB(0), humanity(2500),
+			created(0), lastLogin(0), lastAte(0), lastDrank(0) {}
+
+		int characterId;
+		string playerId;
+		string playerName;
+
+		Sqf::Value worldSpace;
+		Sqf::Value inventory;
+		Sqf::Value backpack;
+		Sqf::Value medical;
+		Sqf::Value currentState;
+		string model;
+
+		int generation;
+		int killsZ;
+		int headshotsZ;
+		int killsH;
+		int killsB;
+		int humanity;
+
+		Int32 created;
+		Int32 lastLogin;
+		Int32 lastAte;
+		Int32 lastDrank;
+	};
+
+	CharacterCache(Poco::Logger& logger, size_t maxEntries, int ttlSeconds);
+	~CharacterCache();
+
+	size_t maxEntries() const { return _maxEntries; }
+
+	//copies of the alive character of a player or the character with an id, counted as hits or misses
+	bool findByPlayer(const string& playerId, Character& out);
+	bool find(int characterId, Character& out);
+
+	//changes a cached character in place, false if it isn't cached
+	typedef boost::function<void(Character&)> ChangeFunc;
+	bool change(int characterId, const ChangeFunc& func);
+	void remove(int characterId);
+
+	//a character is being loaded from the database, any change before it arrives makes the loaded copy outdated
+	void loading(int characterId);
+	//adds a character that was read from the database
+	void loaded(const Character& character);
+	//adds a character read in bulk at startup, unless it's already cached or being loaded (that copy is newer)
+	//or the cache is full, false if it wasn't added
+	bool prewarmed(const Character& character);
+	//the load didn't come through
+	void loadFailed(int characterId);
+private:
+	struct Entry
+	{
+		Character character;
+		Int32 loadedAt;
+	};
+	typedef std::list<Entry> EntryList;
+
+	//the entry if it's there and not expired, moved to the front
+	EntryList::iterator lookup(int characterId);
+	void insert(const Character& character);
+	void erase(EntryList::iterator it);
+	void countLookup(bool hit);
+
+	Poco::Logger& _logger;
+	size_t _maxEntries;
+	int _ttlSeconds;
+
+	Poco::FastMutex _mutex;
+	//most recently used first
+	EntryList _entries;
+	boost::unordered_map<int,EntryList::iterator> _byId;
+	boost::unordered_map<string,int> _byPlayer;
+	//being loaded, and whether they changed in the meantime
+	boost::unordered_map<int,bool> _loading;
+
+	UInt64 _numHits;
+	UInt64 _numMisses;
+};
@@ -447,6 +447,12 @@ CustomDataSource::RequestState CustomDataSource::getRowData( UInt32 token, vecto
 			const Field& fld = res->at(i);
 			if (fld.isNull())
 				outRow[i].reset();
+			else if (Sqf::IsBinary(fld.getCStr(),fld.getLength()))
+			{
+				//binary stored columns go out as the SQF text they stand for
+				try { outRow[i] = Sqf::DecodeBinaryText(fld.getCStr(),fld.getLength()); }
+				catch (const boost::bad_lexical_cast&) { outRow[i] = fld.getString(); }
+			}
 			else
 				outRow[i] = fld.getString();
 		}
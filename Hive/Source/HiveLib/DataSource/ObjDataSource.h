@@ -25,13 +25,70 @@ class ObjDataSource
 public:
 	virtual ~ObjDataSource() {}
 
-	typedef std::queue<Sqf::Parameters> ServerObjectsQueue;
-	virtual void populateObjects( int serverId, ServerObjectsQueue& queue ) = 0;
+	//object rows, already serialized, stored back to back in one buffer
+	class ServerObjectsQueue
+	{
+	public:
+		ServerObjectsQueue() : _front(0) {}
 
-	virtual bool updateObjectInventory( int serverId, Int64 objectIdent, bool byUID, const Sqf::Value& inventory ) = 0;
+		bool empty() const { return _front >= _ends.size(); }
+		size_t size() const { return _ends.size()-_front; }
+		//text of the first row, only valid until the queue changes
+		const char* frontText() const { return _text.data()+rowStart(_front); }
+		size_t frontLength() const { return _ends[_front]-rowStart(_front); }
+		//any row that's still queued, 0 being the first
+		const char* rowText(size_t idx) const { return _text.data()+rowStart(_front+idx); }
+		size_t rowLength(size_t idx) const { return _ends[_front+idx]-rowStart(_front+idx); }
+		void pop()
+		{
+			if (++_front >= _ends.size())
+				clear();
+		}
+
+		//appends rows that are already serialized back to back, ends are relative to the start of text
+		void append(const string& text, const vector<size_t>& ends)
+		{
+			size_t base = _text.length();
+			_text += text;
+			for (auto it=ends.begin();it!=ends.end();++it)
+				_ends.push_back(base+*it);
+		}
+		void swap(ServerObjectsQueue& other)
+		{
+			_text.swap(other._text);
+			_ends.swap(other._ends);
+			std::swap(_front,other._front);
+		}
+		void clear()
+		{
+			string().swap(_text);
+			vector<size_t>().swap(_ends);
+			_front = 0;
+		}
+	private:
+		size_t rowStart(size_t row) const { return (row > 0) ? _ends[row-1] : 0; }
+
+		string _text;
+		vector<size_t> _ends;
+		size_t _front;
+	};
+	//false if the objects could not all be loaded, nothing is queued then
+	virtual bool populateObjects( int serverId, ServerObjectsQueue& queue ) = 0;
+	//the objects last populated for serverId are the ones the server goes with (they might have been loaded ahead of time for another instance)
+	//whatever follows the objects from there on (cleanup, snapshot, held back writes, change feed) is started by this
+	virtual void useLoadedObjects( int serverId ) {}
+
+	//array arguments (inventory, worldspace, hitpoints) arrive already serialized as SQF text
+	virtual bool updateObjectInventory( int serverId, Int64 objectIdent, bool byUID, const string& inventory ) = 0;
 	virtual bool deleteObject( int serverId, Int64 objectIdent, bool byUID ) = 0;
-	virtual bool updateVehicleMovement( int serverId, Int64 objectIdent, const Sqf::Value& worldspace, double fuel ) = 0;
-	virtual bool updateVehicleStatus( int serverId, Int64 objectIdent, const Sqf::Value& hitPoints, double damage ) = 0;
+	virtual bool updateVehicleMovement( int serverId, Int64 objectIdent, const string& worldspace, double fuel ) = 0;
+	virtual bool updateVehicleStatus( int serverId, Int64 objectIdent, const string& hitPoints, double damage ) = 0;
+	//writes out any object updates that are being held back
+	virtual void flushWrites() {}
+	//stream rows of objects inserted or changed in the database after cursor (by anyone), and ObjectIDs of deleted ones
+	//uniqueIds has the ObjectUID of every row (0 if it has none), cursor becomes what to ask with next time, false if changes aren't being followed
+	virtual bool fetchObjectChanges( UInt32& cursor, vector<string>& rows, vector<Int64>& uniqueIds, vector<int>& deletedIds ) { return false; }
+	//objectId gets the ObjectID the new object will have, or 0 if that's only known once it's inserted
 	virtual bool createObject( int serverId, const string& className, double damage, int characterId, 
-		const Sqf::Value& worldSpace, const Sqf::Value& inventory, const Sqf::Value& hitPoints, double fuel, Int64 uniqueId ) = 0;
+		const string& worldSpace, const string& inventory, const string& hitPoints, double fuel, Int64 uniqueId, Int64& objectId ) = 0;
 };
\ No newline at end of file
@@ -0,0 +1,194 @@
+/*
+* Copyright (C) 2009-2013 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "ObjectSnapshot.h"
+
+#include <Poco/Exception.h>
+#include <Poco/File.h>
+#include <Poco/SharedMemory.h>
+
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	//header: magic, version, instance, settings, watermark, row count
+	//then every row as ObjectID, length and text; numbers are stored as the machine has them
+	const char SNAPSHOT_MAGIC[8] = {'H','I','V','E','O','B','J','S'};
+	const UInt32 SNAPSHOT_VERSION = 1;
+
+	class SnapshotReader
+	{
+	public:
+		SnapshotReader(const char* begin, const char* end) : _curr(begin), _end(end) {}
+
+		template<typename T>
+		bool read(T& out)
+		{
+			if (size_t(_end-_curr) < sizeof(out))
+				return false;
+
+			memcpy(&out,_curr,sizeof(out));
+			_curr += sizeof(out);
+			return true;
+		}
+		bool read(const char*& text, size_t length)
+		{
+			if (size_t(_end-_curr) < length)
+				return false;
+
+			text = _curr;
+			_curr += length;
+			return true;
+		}
+		bool readString(string& out)
+		{
+			UInt32 length;
+			const char* text;
+			if (!read(length) || !read(text,length))
+				return false;
+
+			out.assign(text,length);
+			return true;
+		}
+		bool atEnd() const { return _curr == _end; }
+	private:
+		const char* _curr;
+		const char* _end;
+	};
+
+	template<typename T>
+	void WriteRaw(std::ostream& out, const T& val)
+	{
+		out.write(reinterpret_cast<const char*>(&val),sizeof(val));
+	}
+
+	void WriteString(std::ostream& out, const char* text, size_t length)
+	{
+		WriteRaw(out,static_cast<UInt32>(length));
+		out.write(text,length);
+	}
+};
+
+ObjectSnapshot::ObjectSnapshot() {}
+ObjectSnapshot::~ObjectSnapshot() {}
+
+bool ObjectSnapshot::open( const string& fileName, int serverId, const string& settings )
+{
+	close();
+	try
+	{
+		Poco::File file(fileName);
+		if (!file.exists() || file.getSize() == 0)
+			return false;
+
+		_mapping.reset(new Poco::SharedMemory(file,Poco::SharedMemory::AM_READ));
+	}
+	catch (const Poco::Exception&)
+	{
+		_mapping.reset();
+		return false;
+	}
+
+	SnapshotReader reader(_mapping->begin(),_mapping->end());
+	char magic[sizeof(SNAPSHOT_MAGIC)];
+	UInt32 version;
+	Int32 fileServerId;
+	string fileSettings;
+	UInt32 numRows;
+	if (!reader.read(magic) || memcmp(magic,SNAPSHOT_MAGIC,sizeof(magic)) != 0 ||
+		!reader.read(version) || version != SNAPSHOT_VERSION ||
+		!reader.read(fileServerId) || fileServerId != serverId ||
+		!reader.readString(fileSettings) || fileSettings != settings ||
+		!reader.readString(_watermark) || _watermark.empty() ||
+		!reader.read(numRows))
+	{
+		close();
+		return false;
+	}
+
+	_rows.rehash(numRows);
+	for (UInt32 i=0; i<numRows; i++)
+	{
+		Int32 objectId;
+		UInt32 length;
+		Row row;
+		if (!reader.read(objectId) || !reader.read(length) || !reader.read(row.text,length))
+		{
+			close();
+			return false;
+		}
+		row.length = length;
+		_rows[objectId] = row;
+	}
+	if (!reader.atEnd())
+	{
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void ObjectSnapshot::close()
+{
+	_rows.clear();
+	_watermark.clear();
+	_mapping.reset();
+}
+
+bool ObjectSnapshot::Write( const string& fileName, int serverId, const string& settings, const string& watermark,
+	const vector<int>& ids, const string& text, const vector<size_t>& ends )
+{
+	if (ids.size() != ends.size())
+		return false;
+
+	string tempName = fileName + ".tmp";
+	{
+		std::ofstream out(tempName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!out)
+			return false;
+
+		out.write(SNAPSHOT_MAGIC,sizeof(SNAPSHOT_MAGIC));
+		WriteRaw(out,SNAPSHOT_VERSION);
+		WriteRaw(out,static_cast<Int32>(serverId));
+		WriteString(out,settings.data(),settings.length());
+		WriteString(out,watermark.data(),watermark.length());
+		WriteRaw(out,static_cast<UInt32>(ids.size()));
+		for (size_t i=0; i<ids.size(); i++)
+		{
+			size_t start = (i > 0) ? ends[i-1] : 0;
+			WriteRaw(out,static_cast<Int32>(ids[i]));
+			WriteString(out,text.data()+start,ends[i]-start);
+		}
+
+		out.flush();
+		if (!out)
+			return false;
+	}
+
+	try
+	{
+		Poco::File(tempName).renameTo(fileName);
+	}
+	catch (const Poco::Exception&)
+	{
+		return false;
+	}
+	return true;
+}
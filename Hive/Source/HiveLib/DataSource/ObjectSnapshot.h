@@ -0,0 +1,59 @@
+/*
+* Copyright (C) 2009-2013 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "Shared/Common/Types.h"
+
+#include <boost/unordered_map.hpp>
+
+namespace Poco { class SharedMemory; };
+
+//serialized object rows from the last load, kept in a file together with the database time the load started at,
+//so the next load only has to fetch the rows that changed after that
+class ObjectSnapshot
+{
+public:
+	//points into the mapped file
+	struct Row
+	{
+		const char* text;
+		size_t length;
+	};
+	typedef boost::unordered_map<int,Row> RowMap;
+
+	ObjectSnapshot();
+	~ObjectSnapshot();
+
+	//maps the file, false if it's missing, damaged or was written for another instance or other settings
+	bool open(const string& fileName, int serverId, const string& settings);
+	//unmaps the file, rows aren't valid anymore after this
+	void close();
+
+	const string& watermark() const { return _watermark; }
+	const RowMap& rows() const { return _rows; }
+
+	//rows are given the same way ServerObjectsQueue stores them, with their ObjectIDs alongside
+	//the file is written under a temporary name first, so a failed write leaves the old one alone
+	static bool Write(const string& fileName, int serverId, const string& settings, const string& watermark,
+		const vector<int>& ids, const string& text, const vector<size_t>& ends);
+private:
+	unique_ptr<Poco::SharedMemory> _mapping;
+	string _watermark;
+	RowMap _rows;
+};
@@ -0,0 +1,145 @@
+/*
+* Copyright (C) 2009-2012 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "SqlBinaryMigrator.h"
+#include "Database/Database.h"
+#include "../Sqf.h"
+
+#include <boost/lexical_cast.hpp>
+using boost::lexical_cast;
+
+SqlBinaryMigrator::SqlBinaryMigrator(Poco::Logger& logger, shared_ptr<Database> db, const string& tableName, 
+	const string& keyField, const vector<string>& fields, size_t batchSize, bool compress) 
+	: _logger(logger), _db(db), _tableName(tableName), _keyField(keyField), _fields(fields), _batchSize(batchSize), _compress(compress),
+	_thread("SQF Binary Migrator"), _isRunning(false), _lastKey(0), _numConverted(0), _numFailed(0), _stmtConvertField(fields.size())
+{
+}
+
+SqlBinaryMigrator::~SqlBinaryMigrator()
+{
+	stop();
+}
+
+void SqlBinaryMigrator::start()
+{
+	if (_isRunning)
+		return;
+
+	_isRunning = true;
+	_thread.start(*this);
+}
+
+void SqlBinaryMigrator::stop()
+{
+	if (!_isRunning)
+		return;
+
+	_isRunning = false;	//send stop signal
+	_thread.join();		//wait for current batch to finish
+}
+
+void SqlBinaryMigrator::run()
+{
+	_db->threadEnter();
+
+	const long batchSleepMS = 250;
+
+	_logger.information("Converting SQF columns of " + _tableName + " to binary");
+	bool finished = false;
+	bool failed = false;
+	while (_isRunning)
+	{
+		if (!migrateBatch(finished))
+		{
+			failed = true;
+			break;
+		}
+		if (finished)
+			break;
+		Poco::Thread::sleep(batchSleepMS);
+	}
+	if (failed)
+		_logger.error("Gave up converting " + _tableName + " at " + _keyField + " " + lexical_cast<string>(_lastKey) + ", " + lexical_cast<string>(_numConverted) + " values converted");
+	else if (finished && _numFailed > 0)
+		_logger.error("Finished converting " + _tableName + ", " + lexical_cast<string>(_numConverted) + " values converted, " + lexical_cast<string>(_numFailed) + " failed");
+	else if (finished)
+		_logger.information("Finished converting " + _tableName + ", " + lexical_cast<string>(_numConverted) + " values converted");
+	else
+		_logger.information("Stopped converting " + _tableName + " at " + _keyField + " " + lexical_cast<string>(_lastKey));
+
+	_db->threadExit();
+}
+
+bool SqlBinaryMigrator::migrateBatch( bool& done )
+{
+	string sql = "SELECT `" + _keyField + "`";
+	for (auto it=_fields.begin();it!=_fields.end();++it)
+		sql += ", `" + *it + "`";
+	sql += " FROM `" + _tableName + "` WHERE `" + _keyField + "` > " + lexical_cast<string>(_lastKey) + 
+		" ORDER BY `" + _keyField + "` LIMIT " + lexical_cast<string>(_batchSize);
+
+	auto batchRes = _db->query(sql.c_str());
+	if (!batchRes)
+	{
+		_logger.error("Failed to fetch rows of " + _tableName + " for conversion");
+		return false;
+	}
+
+	size_t numRows = 0;
+	while (batchRes->fetchRow())
+	{
+		numRows++;
+		auto row = batchRes->fields();
+		_lastKey = row[0].getUInt64();
+
+		for (size_t i=0; i<_fields.size(); i++)
+		{
+			const Field& fld = row[i+1];
+			if (fld.isNull() || Sqf::IsBinary(fld.getCStr(),fld.getLength()))
+				continue;
+
+			string sqfText = fld.getString();
+			Sqf::Value val;
+			if (!Sqf::ParseValue(sqfText.c_str(),sqfText.length(),val))
+			{
+				_logger.warning("Not converting invalid " + _fields[i] + " of " + _keyField + " " + lexical_cast<string>(_lastKey) + ": " + sqfText);
+				continue;
+			}
+			ByteVector bin = Sqf::EncodeBinary(val,_compress);
+			if (bin.size() >= sqfText.length())
+				continue;
+
+			//only if nothing wrote to it since it was read
+			auto stmt = _db->makeStatement(_stmtConvertField[i], 
+				"UPDATE `" + _tableName + "` SET `" + _fields[i] + "` = ? WHERE `" + _keyField + "` = ? AND `" + _fields[i] + "` = ?");
+			stmt->addBinary(std::move(bin));
+			stmt->addUInt64(_lastKey);
+			stmt->addString(std::move(sqfText));
+			if (stmt->directExecute())
+				_numConverted++;
+			else
+			{
+				_numFailed++;
+				_logger.error("Error converting " + _fields[i] + " of " + _keyField + " " + lexical_cast<string>(_lastKey));
+			}
+		}
+	}
+
+	done = (numRows == 0);
+	return true;
+}
@@ -0,0 +1,62 @@
+/*
+* Copyright (C) 2009-2012 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "Shared/Common/Types.h"
+#include "Database/SqlStatement.h"
+
+#include <Poco/Runnable.h>
+#include <Poco/Thread.h>
+
+namespace Poco { class Logger; };
+class Database;
+
+//converts the SQF text columns of a table to the binary encoding in the background
+//rows are visited in key order, a few at a time, and a value is only replaced if it's still the text that was read
+class SqlBinaryMigrator : public Poco::Runnable
+{
+public:
+	SqlBinaryMigrator(Poco::Logger& logger, shared_ptr<Database> db, const string& tableName, 
+		const string& keyField, const vector<string>& fields, size_t batchSize, bool compress);
+	~SqlBinaryMigrator();
+
+	void start();
+	void stop();
+	void run() override;
+private:
+	//false if the rows couldn't be fetched, done is set once there are no more rows
+	bool migrateBatch(bool& done);
+
+	Poco::Logger& _logger;
+	shared_ptr<Database> _db;
+	string _tableName;
+	string _keyField;
+	vector<string> _fields;
+	size_t _batchSize;
+	bool _compress;
+
+	Poco::Thread _thread;
+	volatile bool _isRunning;
+	UInt64 _lastKey;
+	size_t _numConverted;
+	size_t _numFailed;
+
+	//statement ids, one per field
+	vector<SqlStatementID> _stmtConvertField;
+};
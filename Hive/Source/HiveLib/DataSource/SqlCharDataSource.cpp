@@ -17,12 +17,134 @@
 */
 
 #include "SqlCharDataSource.h"
+#include "WriteFilter.h"
+#include "CharacterCache.h"
+#include "SqlCharWriteCache.h"
 #include "Database/Database.h"
+#include "Shared/Common/Timer.h"
 
+#include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
 using boost::lexical_cast;
 using boost::bad_lexical_cast;
 
+namespace
+{
+	//fields of a character update, as bits of the masks its statements are kept by
+	//whole fields come first, only those can be compared with what was written before
+	//they and the additive ones are in the same order as the columns and counters of SqlCharWriteCache
+	enum CharField
+	{
+		CF_WORLDSPACE,
+		CF_INVENTORY,
+		CF_BACKPACK,
+		CF_MEDICAL,
+		CF_CURRENTSTATE,
+		CF_MODEL,
+		NUM_WHOLE_FIELDS,
+		CF_LASTATE = NUM_WHOLE_FIELDS,
+		CF_LASTDRANK,
+		CF_KILLSZ,
+		CF_HEADSHOTSZ,
+		CF_DISTANCEFOOT,
+		CF_DURATION,
+		CF_KILLSH,
+		CF_KILLSB,
+		CF_HUMANITY,
+		NUM_CHAR_FIELDS
+	};
+	//names the scripts send them as
+	const char* CHAR_FIELD_NAMES[NUM_CHAR_FIELDS] = { "Worldspace", "Inventory", "Backpack", "Medical", "CurrentState", "Model", 
+		"JustAte", "JustDrank", "KillsZ", "HeadshotsZ", "DistanceFoot", "Duration", "KillsH", "KillsB", "Humanity" };
+	const char* CHAR_FIELD_COLUMNS[NUM_CHAR_FIELDS] = { "Worldspace", "Inventory", "Backpack", "Medical", "CurrentState", "Model", 
+		"LastAte", "LastDrank", "KillsZ", "HeadshotsZ", "DistanceFoot", "Duration", "KillsH", "KillsB", "Humanity" };
+
+	const boost::unordered_map<string,int>& CharFieldLookup()
+	{
+		static boost::unordered_map<string,int> lookup;
+		if (lookup.empty())
+		{
+			for (int i=0; i<NUM_CHAR_FIELDS; i++)
+				lookup[CHAR_FIELD_NAMES[i]] = i;
+		}
+		return lookup;
+	}
+
+	//models are stored as SQF strings, older rows might have them without the quotes
+	string ModelName(const Field& fld)
+	{
+		try
+		{
+			return boost::get<string>(lexical_cast<Sqf::Value>(fld.getString()));
+		}
+		catch(...)
+		{
+			return fld.getString();
+		}
+	}
+
+	Sqf::Value LoginResult(bool newPlayer, int characterId, bool newChar, const Sqf::Value& worldSpace, const Sqf::Value& inventory, 
+		const Sqf::Value& backpack, const Sqf::Value& survival, const string& model)
+	{
+		Sqf::Parameters retVal;
+		retVal.push_back(string("PASS"));
+		retVal.push_back(newPlayer);
+		retVal.push_back(lexical_cast<string>(characterId));
+		if (!newChar)
+		{
+			retVal.push_back(worldSpace);
+			retVal.push_back(inventory);
+			retVal.push_back(backpack);
+			retVal.push_back(survival);
+		}
+		retVal.push_back(model);
+		//hive interface version
+		retVal.push_back(0.96f);
+
+		return retVal;
+	}
+
+	//the same changes a character update makes in the database
+	void ApplyUpdate(CharacterCache::Character& character, const CharDataSource::FieldsType& fields, int wsDecimals)
+	{
+		const boost::unordered_map<string,int>& lookup = CharFieldLookup();
+		for (auto it=fields.begin();it!=fields.end();++it)
+		{
+			auto fieldIt = lookup.find(it->first);
+			if (fieldIt == lookup.end())
+				continue;
+
+			const Sqf::Value& val = it->second;
+			switch (fieldIt->second)
+			{
+			case CF_WORLDSPACE:
+				character.worldSpace = val;
+				Sqf::RoundNumbers(character.worldSpace,wsDecimals);
+				break;
+			case CF_INVENTORY: character.inventory = val; break;
+			case CF_BACKPACK: character.backpack = val; break;
+			case CF_MEDICAL: character.medical = val; break;
+			case CF_CURRENTSTATE: character.currentState = val; break;
+			case CF_MODEL: character.model = boost::get<string>(val); break;
+			case CF_LASTATE:
+				if (boost::get<bool>(val))
+					character.lastAte = GlobalTimer::getTime();
+				break;
+			case CF_LASTDRANK:
+				if (boost::get<bool>(val))
+					character.lastDrank = GlobalTimer::getTime();
+				break;
+			case CF_KILLSZ: character.killsZ += static_cast<int>(Sqf::GetDouble(val)); break;
+			case CF_HEADSHOTSZ: character.headshotsZ += static_cast<int>(Sqf::GetDouble(val)); break;
+			case CF_KILLSH: character.killsH += static_cast<int>(Sqf::GetDouble(val)); break;
+			case CF_KILLSB: character.killsB += static_cast<int>(Sqf::GetDouble(val)); break;
+			case CF_HUMANITY: character.humanity += static_cast<int>(Sqf::GetDouble(val)); break;
+			default: break; //distance and duration aren't cached
+			}
+		}
+	}
+};
+
 SqlCharDataSource::SqlCharDataSource( Poco::Logger& logger, shared_ptr<Database> db, const string& idFieldName, const string& wsFieldName ) : SqlDataSource(logger,db)
 {
 	_idFieldName = getDB()->escape(idFieldName);
@@ -31,61 +153,280 @@ SqlCharDataSource::SqlCharDataSource( Poco::Logger& logger, shared_ptr<Database>
 
 SqlCharDataSource::~SqlCharDataSource() {}
 
+void SqlCharDataSource::setSkipUnchanged( bool enabled )
+{
+	if (enabled)
+		_writeFilter.reset(new WriteFilter(_logger,"character",NUM_WHOLE_FIELDS));
+	else
+		_writeFilter.reset();
+}
+
+void SqlCharDataSource::setLoginProcedure( const string& procName )
+{
+	_loginProcedure = getDB()->escape(procName);
+}
+
+void SqlCharDataSource::setCache( size_t maxEntries, int ttlSeconds )
+{
+	if (maxEntries > 0)
+		_charCache.reset(new CharacterCache(_logger,maxEntries,ttlSeconds));
+	else
+		_charCache.reset();
+}
+
+void SqlCharDataSource::setWriteInterval( int seconds )
+{
+	if (seconds > 0)
+	{
+		_writeCache.reset(new SqlCharWriteCache(_logger,getSharedDB(),_wsFieldName,seconds*1000L));
+		_writeCache->start();
+	}
+	else
+		_writeCache.reset();
+}
+
+void SqlCharDataSource::flushWrites()
+{
+	if (_writeCache)
+		_writeCache->flush();
+}
+
+void SqlCharDataSource::prewarmCache( int hours )
+{
+	if (!_charCache || hours <= 0)
+		return;
+
+	weak_ptr<CharacterCache> cache = _charCache;
+	getDB()->asyncQueryParams([this,cache,hours](QueryCallback::ResType res)
+		{
+			//the datasource went away with it
+			if (!cache.lock())
+				return;
+
+			if (!res)
+			{
+				_logger.warning("Error prewarming character cache");
+				return;
+			}
+			int numCached = cacheRows(*res,true);
+			_logger.information("Prewarmed character cache with " + lexical_cast<string>(numCached) + " characters from the last " + lexical_cast<string>(hours) + " hours");
+		}, (cacheQuery()+" WHERE c.`Alive` = 1 AND c.`LastLogin` > DATE_SUB(NOW(), INTERVAL %d HOUR) ORDER BY c.`LastLogin` DESC LIMIT %d").c_str(), 
+		hours, static_cast<int>(_charCache->maxEntries()));
+}
+
+string SqlCharDataSource::cacheQuery() const
+{
+	return "SELECT c.`CharacterID`, c.`"+_idFieldName+"`, p.`PlayerName`, c.`"+_wsFieldName+"`, c.`Inventory`, c.`Backpack`, c.`Medical`, c.`CurrentState`, c.`Model`, "
+		"c.`Generation`, c.`KillsZ`, c.`HeadshotsZ`, c.`KillsH`, c.`KillsB`, c.`Humanity`, "
+		"TIMESTAMPDIFF(SECOND,c.`Datestamp`,NOW()) as `SecsAlive`, "
+		"TIMESTAMPDIFF(SECOND,c.`LastLogin`,NOW()) as `SecsSinceLogin`, "
+		"TIMESTAMPDIFF(SECOND,c.`LastAte`,NOW()) as `SecsLastAte`, "
+		"TIMESTAMPDIFF(SECOND,c.`LastDrank`,NOW()) as `SecsLastDrank` "
+		"FROM `Character_DATA` c JOIN `Player_DATA` p ON p.`"+_idFieldName+"` = c.`"+_idFieldName+"`";
+}
+
+void SqlCharDataSource::prefetchCharacter( int characterId )
+{
+	_charCache->loading(characterId);
+
+	//queued behind the writes that were made so far, so it reads what they wrote
+	weak_ptr<CharacterCache> cache = _charCache;
+	getDB()->asyncQueryParams([this,cache,characterId](QueryCallback::ResType res)
+		{
+			shared_ptr<CharacterCache> charCache = cache.lock();
+			if (!charCache)
+				return;
+
+			if (!res || cacheRows(*res,false) < 1)
+				charCache->loadFailed(characterId);
+		}, (cacheQuery()+" WHERE c.`CharacterID` = %d").c_str(), characterId);
+}
+
+int SqlCharDataSource::cacheRows( QueryResult& res, bool prewarm )
+{
+	const Int32 now = GlobalTimer::getTime();
+	int numCached = 0;
+	while (res.fetchRow())
+	{
+		CharacterCache::Character character;
+		character.characterId = res.at(0).getInt32();
+		character.playerId = res.at(1).getString();
+		character.playerName = res.at(2).getString();
+		try
+		{
+			character.worldSpace = rawStored(res.at(3),precision().worldspace);
+			character.inventory = res.at(4).isNull() ? lexical_cast<Sqf::Value>("[]") : parseStored(res.at(4));
+			character.backpack = res.at(5).isNull() ? lexical_cast<Sqf::Value>("[]") : rawStored(res.at(5));
+			character.medical = rawStored(res.at(6));
+			character.currentState = rawStored(res.at(7));
+		}
+		catch(bad_lexical_cast)
+		{
+			//left to the database queries, which know what to do with it
+			if (!prewarm)
+				_charCache->loadFailed(character.characterId);
+			continue;
+		}
+		character.model = ModelName(res.at(8));
+		character.generation = res.at(9).getInt32();
+		character.killsZ = res.at(10).getInt32();
+		character.headshotsZ = res.at(11).getInt32();
+		character.killsH = res.at(12).getInt32();
+		character.killsB = res.at(13).getInt32();
+		character.humanity = res.at(14).getInt32();
+		character.created = now - res.at(15).getInt32();
+		character.lastLogin = now - res.at(16).getInt32();
+		character.lastAte = now - res.at(17).getInt32();
+		character.lastDrank = now - res.at(18).getInt32();
+
+		if (prewarm)
+		{
+			if (!_charCache->prewarmed(character))
+				continue;
+		}
+		else
+			_charCache->loaded(character);
+
+		numCached++;
+	}
+	return numCached;
+}
+
 Sqf::Value SqlCharDataSource::fetchCharacterInitial( string playerId, int serverId, const string& playerName )
 {
-	bool newPlayer = false;
-	//make sure player exists in db
+	if (_charCache)
 	{
-		auto playerRes(getDB()->queryParams(("SELECT `PlayerName`, `PlayerSex` FROM `Player_DATA` WHERE `"+_idFieldName+"`='%s'").c_str(), getDB()->escape(playerId).c_str()));
-		if (playerRes && playerRes->fetchRow())
+		getDB()->invokeCallbacks(); //background loads
+
+		CharacterCache::Character cached;
+		if (_charCache->findByPlayer(playerId,cached))
 		{
-			newPlayer = false;
-			//update player name if not current
-			if (playerRes->at(0).getString() != playerName)
+			const Int32 now = GlobalTimer::getTime();
+			if (cached.playerName != playerName)
 			{
 				auto stmt = getDB()->makeStatement(_stmtChangePlayerName, "UPDATE `Player_DATA` SET `PlayerName`=? WHERE `"+_idFieldName+"`=?");
 				stmt->addString(playerName);
 				stmt->addString(playerId);
 				bool exRes = stmt->execute();
 				poco_assert(exRes == true);
-				_logger.information("Changed name of player " + playerId + " from '" + playerRes->at(0).getString() + "' to '" + playerName + "'");
+				_logger.information("Changed name of player " + playerId + " from '" + cached.playerName + "' to '" + playerName + "'");
 			}
+			{
+				auto stmt = getDB()->makeStatement(_stmtUpdateCharacterLastLogin, "UPDATE `Character_DATA` SET `LastLogin` = CURRENT_TIMESTAMP WHERE `CharacterID` = ?");
+				stmt->addInt32(cached.characterId);
+				bool exRes = stmt->execute();
+				poco_assert(exRes == true);
+			}
+			_charCache->change(cached.characterId,[&](CharacterCache::Character& character)
+				{
+					character.playerName = playerName;
+					character.lastLogin = now;
+				});
+			if (_writeFilter)
+				_writeFilter->forget(cached.characterId);
+
+			//survival time is counted up to the previous login, like the query does
+			Sqf::Parameters survival;
+			survival.push_back((cached.lastLogin - cached.created) / 60);
+			survival.push_back((now - cached.lastAte) / 60);
+			survival.push_back((now - cached.lastDrank) / 60);
+			Sqf::Value inventory = cached.inventory;
+			try { SanitiseInv(boost::get<Sqf::Parameters>(inventory)); } catch (const boost::bad_get&) {}
+
+			return LoginResult(false,cached.characterId,false,cached.worldSpace,inventory,cached.backpack,survival,cached.model);
 		}
-		else
+	}
+
+	//the queries below have to see the held back updates
+	if (_writeCache)
+		_writeCache->flush();
+
+	bool newPlayer = false;
+	bool newChar = false; //not a new char
+	unique_ptr<QueryResult> charsRes;
+	if (!_loginProcedure.empty())
+	{
+		//the procedure does the player and character lookups, the name change or new player and the new character in one go
+		//first result is the player, second one is the character in the same layout as the query below
+		charsRes = getDB()->queryParams("CALL `%s`('%s','%s',%d)", _loginProcedure.c_str(), 
+			getDB()->escape(playerId).c_str(), getDB()->escape(playerName).c_str(), serverId);
+		if (!charsRes || !charsRes->fetchRow())
 		{
-			newPlayer = true;
-			//insert new player into db
-			auto stmt = getDB()->makeStatement(_stmtInsertPlayer, "INSERT INTO `Player_DATA` (`"+_idFieldName+"`, `PlayerName`) VALUES (?, ?)");
-			stmt->addString(playerId);
-			stmt->addString(playerName);
-			bool exRes = stmt->execute();
-			poco_assert(exRes == true);
+			_logger.error("Error logging in playerId " + playerId + " through " + _loginProcedure);
+			Sqf::Parameters retVal;
+			retVal.push_back(string("ERROR"));
+			return retVal;
+		}
+
+		newPlayer = charsRes->at(0).getBool();
+		if (newPlayer)
 			_logger.information("Created a new player " + playerId + " named '" + playerName + "'");
+		else if (!charsRes->at(1).isNull()) //only there if the name changed
+			_logger.information("Changed name of player " + playerId + " from '" + charsRes->at(1).getString() + "' to '" + playerName + "'");
+
+		if (!charsRes->nextResult() || !charsRes->fetchRow())
+		{
+			_logger.error("Error fetching character through " + _loginProcedure + " for playerId " + playerId);
+			Sqf::Parameters retVal;
+			retVal.push_back(string("ERROR"));
+			return retVal;
 		}
+		newChar = charsRes->at(8).getBool();
 	}
+	else
+	{
+		//make sure player exists in db
+		{
+			auto playerRes(getDB()->queryParams(("SELECT `PlayerName`, `PlayerSex` FROM `Player_DATA` WHERE `"+_idFieldName+"`='%s'").c_str(), getDB()->escape(playerId).c_str()));
+			if (playerRes && playerRes->fetchRow())
+			{
+				newPlayer = false;
+				//update player name if not current
+				if (playerRes->at(0).getString() != playerName)
+				{
+					auto stmt = getDB()->makeStatement(_stmtChangePlayerName, "UPDATE `Player_DATA` SET `PlayerName`=? WHERE `"+_idFieldName+"`=?");
+					stmt->addString(playerName);
+					stmt->addString(playerId);
+					bool exRes = stmt->execute();
+					poco_assert(exRes == true);
+					_logger.information("Changed name of player " + playerId + " from '" + playerRes->at(0).getString() + "' to '" + playerName + "'");
+				}
+			}
+			else
+			{
+				newPlayer = true;
+				//insert new player into db
+				auto stmt = getDB()->makeStatement(_stmtInsertPlayer, "INSERT INTO `Player_DATA` (`"+_idFieldName+"`, `PlayerName`) VALUES (?, ?)");
+				stmt->addString(playerId);
+				stmt->addString(playerName);
+				bool exRes = stmt->execute();
+				poco_assert(exRes == true);
+				_logger.information("Created a new player " + playerId + " named '" + playerName + "'");
+			}
+		}
 
-	//get characters from db
-	auto charsRes = getDB()->queryParams(
-		("SELECT `CharacterID`, `"+_wsFieldName+"`, `Inventory`, `Backpack`, "
-		"TIMESTAMPDIFF(MINUTE,`Datestamp`,`LastLogin`) as `SurvivalTime`, "
-		"TIMESTAMPDIFF(MINUTE,`LastAte`,NOW()) as `MinsLastAte`, "
-		"TIMESTAMPDIFF(MINUTE,`LastDrank`,NOW()) as `MinsLastDrank`, "
-		"`Model` FROM `Character_DATA` WHERE `"+_idFieldName+"` = '%s' AND `Alive` = 1 ORDER BY `CharacterID` DESC LIMIT 1").c_str(), getDB()->escape(playerId).c_str());
+		//get characters from db
+		charsRes = getDB()->queryParams(
+			("SELECT `CharacterID`, `"+_wsFieldName+"`, `Inventory`, `Backpack`, "
+			"TIMESTAMPDIFF(MINUTE,`Datestamp`,`LastLogin`) as `SurvivalTime`, "
+			"TIMESTAMPDIFF(MINUTE,`LastAte`,NOW()) as `MinsLastAte`, "
+			"TIMESTAMPDIFF(MINUTE,`LastDrank`,NOW()) as `MinsLastDrank`, "
+			"`Model` FROM `Character_DATA` WHERE `"+_idFieldName+"` = '%s' AND `Alive` = 1 ORDER BY `CharacterID` DESC LIMIT 1").c_str(), getDB()->escape(playerId).c_str());
+		newChar = !charsRes || !charsRes->fetchRow();
+	}
 
-	bool newChar = false; //not a new char
 	int characterId = -1; //invalid charid
 	Sqf::Value worldSpace = Sqf::Parameters(); //empty worldspace
 	Sqf::Value inventory = lexical_cast<Sqf::Value>("[]"); //empty inventory
 	Sqf::Value backpack = lexical_cast<Sqf::Value>("[]"); //empty backpack
 	Sqf::Value survival = lexical_cast<Sqf::Value>("[0,0,0]"); //0 mins alive, 0 mins since last ate, 0 mins since last drank
 	string model = ""; //empty models will be defaulted by scripts
-	if (charsRes && charsRes->fetchRow())
+	if (!newChar)
 	{
-		newChar = false;
 		characterId = charsRes->at(0).getInt32();
 		try
 		{
-			worldSpace = lexical_cast<Sqf::Value>(charsRes->at(1).getString());
+			worldSpace = rawStored(charsRes->at(1),precision().worldspace);
 		}
 		catch(bad_lexical_cast)
 		{
@@ -95,7 +436,7 @@ Sqf::Value SqlCharDataSource::fetchCharacterInitial( string playerId, int server
 		{
 			try
 			{
-				inventory = lexical_cast<Sqf::Value>(charsRes->at(2).getString());
+				inventory = parseStored(charsRes->at(2));
 				try { SanitiseInv(boost::get<Sqf::Parameters>(inventory)); } catch (const boost::bad_get&) {}
 			}
 			catch(bad_lexical_cast)
@@ -107,7 +448,7 @@ Sqf::Value SqlCharDataSource::fetchCharacterInitial( string playerId, int server
 		{
 			try
 			{
-				backpack = lexical_cast<Sqf::Value>(charsRes->at(3).getString());
+				backpack = rawStored(charsRes->at(3));
 			}
 			catch(bad_lexical_cast)
 			{
@@ -121,16 +462,10 @@ Sqf::Value SqlCharDataSource::fetchCharacterInitial( string playerId, int server
 			survivalArr[1] = charsRes->at(5).getInt32();
 			survivalArr[2] = charsRes->at(6).getInt32();
 		}
-		try
-		{
-			model = boost::get<string>(lexical_cast<Sqf::Value>(charsRes->at(7).getString()));
-		}
-		catch(...)
-		{
-			model = charsRes->at(7).getString();
-		}
+		model = ModelName(charsRes->at(7));
 
-		//update last login
+		//update last login (the procedure already did)
+		if (_loginProcedure.empty())
 		{
 			//update last character login
 			auto stmt = getDB()->makeStatement(_stmtUpdateCharacterLastLogin, "UPDATE `Character_DATA` SET `LastLogin` = CURRENT_TIMESTAMP WHERE `CharacterID` = ?");
@@ -139,10 +474,14 @@ Sqf::Value SqlCharDataSource::fetchCharacterInitial( string playerId, int server
 			poco_assert(exRes == true);
 		}
 	}
+	else if (!_loginProcedure.empty()) //procedure inserted the new character
+	{
+		characterId = charsRes->at(0).getInt32();
+		model = ModelName(charsRes->at(7));
+		_logger.information("Created a new character " + lexical_cast<string>(characterId) + " for player '" + playerName + "' (" + playerId + ")" );
+	}
 	else //inserting new character
 	{
-		newChar = true;
-
 		int generation = 1;
 		int humanity = 2500;
 		//try getting previous character info
@@ -155,14 +494,7 @@ Sqf::Value SqlCharDataSource::fetchCharacterInitial( string playerId, int server
 				generation++; //apparently this was the correct behaviour all along
 
 				humanity = prevCharRes->at(1).getInt32();
-				try
-				{
-					model = boost::get<string>(lexical_cast<Sqf::Value>(prevCharRes->at(2).getString()));
-				}
-				catch(...)
-				{
-					model = prevCharRes->at(2).getString();
-				}
+				model = ModelName(prevCharRes->at(2));
 			}
 		}
 		Sqf::Value medical = Sqf::Parameters(); //script will fill this in if empty
@@ -173,13 +505,14 @@ Sqf::Value SqlCharDataSource::fetchCharacterInitial( string playerId, int server
 				"VALUES (?, ?, ?, ?, ?, ?, ?, CURRENT_TIMESTAMP, CURRENT_TIMESTAMP, CURRENT_TIMESTAMP, CURRENT_TIMESTAMP, ?)");
 			stmt->addString(playerId);
 			stmt->addInt32(serverId);
-			stmt->addString(lexical_cast<string>(worldSpace));
-			stmt->addString(lexical_cast<string>(inventory));
-			stmt->addString(lexical_cast<string>(backpack));
-			stmt->addString(lexical_cast<string>(medical));
+			bindStored(*stmt,worldSpace);
+			bindStored(*stmt,inventory);
+			bindStored(*stmt,backpack);
+			bindStored(*stmt,medical);
 			stmt->addInt32(generation);
 			stmt->addInt32(humanity);
-			bool exRes = stmt->directExecute(); //need sync as we will be getting the CharacterID right after this
+			SqlExecResult insertRes;
+			bool exRes = stmt->directExecute(insertRes); //need sync as we will be getting the CharacterID right after this
 			if (exRes == false)
 			{
 				_logger.error("Error creating character for playerId " + playerId);
@@ -187,8 +520,10 @@ Sqf::Value SqlCharDataSource::fetchCharacterInitial( string playerId, int server
 				retVal.push_back(string("ERROR"));
 				return retVal;
 			}
+			characterId = static_cast<int>(insertRes.insertId);
 		}
-		//get the new character's id
+		//get the new character's id, if the database didn't say what it was
+		if (characterId <= 0)
 		{
 			auto newCharRes = getDB()->queryParams(
 				("SELECT `CharacterID` FROM `Character_DATA` WHERE `"+_idFieldName+"` = '%s' AND `Alive` = 1 ORDER BY `CharacterID` DESC LIMIT 1").c_str(), getDB()->escape(playerId).c_str());
@@ -204,27 +539,49 @@ Sqf::Value SqlCharDataSource::fetchCharacterInitial( string playerId, int server
 		_logger.information("Created a new character " + lexical_cast<string>(characterId) + " for player '" + playerName + "' (" + playerId + ")" );
 	}
 
-	Sqf::Parameters retVal;
-	retVal.push_back(string("PASS"));
-	retVal.push_back(newPlayer);
-	retVal.push_back(lexical_cast<string>(characterId));
-	if (!newChar)
-	{
-		retVal.push_back(worldSpace);
-		retVal.push_back(inventory);
-		retVal.push_back(backpack);
-		retVal.push_back(survival);
-	}
-	retVal.push_back(model);
-	//hive interface version
-	retVal.push_back(0.96f);
+	//whatever is in the database now is what the scripts start from
+	if (_writeFilter)
+		_writeFilter->forget(characterId);
 
-	return retVal;
+	//so the details request that comes next doesn't need the database
+	if (_charCache)
+		prefetchCharacter(characterId);
+
+	return LoginResult(newPlayer,characterId,newChar,worldSpace,inventory,backpack,survival,model);
 }
 
 Sqf::Value SqlCharDataSource::fetchCharacterDetails( int characterId )
 {
+	if (_writeFilter)
+		_writeFilter->forget(characterId);
+
 	Sqf::Parameters retVal;
+	if (_charCache)
+	{
+		getDB()->invokeCallbacks(); //background loads
+
+		CharacterCache::Character cached;
+		if (_charCache->find(characterId,cached))
+		{
+			Sqf::Parameters stats; //killsZ, headZ, killsH, killsB
+			stats.push_back(cached.killsZ);
+			stats.push_back(cached.headshotsZ);
+			stats.push_back(cached.killsH);
+			stats.push_back(cached.killsB);
+
+			retVal.push_back(string("PASS"));
+			retVal.push_back(cached.medical);
+			retVal.push_back(stats);
+			retVal.push_back(cached.currentState);
+			retVal.push_back(cached.worldSpace);
+			retVal.push_back(cached.humanity);
+			return retVal;
+		}
+	}
+
+	if (_writeCache)
+		_writeCache->flush(characterId);
+
 	//get details from db
 	auto charDetRes = getDB()->queryParams(
 		"SELECT `%s`, `Medical`, `Generation`, `KillsZ`, `HeadshotsZ`, `KillsH`, `KillsB`, `CurrentState`, `Humanity` "
@@ -242,7 +599,7 @@ Sqf::Value SqlCharDataSource::fetchCharacterDetails( int characterId )
 		{
 			try
 			{
-				worldSpace = lexical_cast<Sqf::Value>(charDetRes->at(0).getString());
+				worldSpace = rawStored(charDetRes->at(0),precision().worldspace);
 			}
 			catch(bad_lexical_cast)
 			{
@@ -250,7 +607,7 @@ Sqf::Value SqlCharDataSource::fetchCharacterDetails( int characterId )
 			}
 			try
 			{
-				medical = lexical_cast<Sqf::Value>(charDetRes->at(1).getString());
+				medical = rawStored(charDetRes->at(1));
 			}
 			catch(bad_lexical_cast)
 			{
@@ -267,7 +624,7 @@ Sqf::Value SqlCharDataSource::fetchCharacterDetails( int characterId )
 			}
 			try
 			{
-				currentState = lexical_cast<Sqf::Value>(charDetRes->at(7).getString());
+				currentState = rawStored(charDetRes->at(7));
 			}
 			catch(bad_lexical_cast)
 			{
@@ -293,77 +650,157 @@ Sqf::Value SqlCharDataSource::fetchCharacterDetails( int characterId )
 
 bool SqlCharDataSource::updateCharacter( int characterId, const FieldsType& fields )
 {
-	map<string,string> sqlFields;
+	//SQF text of whole fields (just the name for Model), amounts of the additive ones
+	string wholeValues[NUM_WHOLE_FIELDS];
+	int addValues[NUM_CHAR_FIELDS];
+	UInt32 fieldMask = 0;
 
+	const boost::unordered_map<string,int>& lookup = CharFieldLookup();
 	for (auto it=fields.begin();it!=fields.end();++it)
 	{
-		const string& name = it->first;
-		const Sqf::Value& val = it->second;
+		auto fieldIt = lookup.find(it->first);
+		if (fieldIt == lookup.end())
+			continue;
 
+		const int field = fieldIt->second;
+		const Sqf::Value& val = it->second;
 		//arrays
-		if (name == "Worldspace" || name == "Inventory" || name == "Backpack" || name == "Medical" || name == "CurrentState")
-			sqlFields[name] = "'"+getDB()->escape(lexical_cast<string>(val))+"'";
+		if (field == CF_WORLDSPACE)
+		{
+			Sqf::Value rounded = val;
+			Sqf::RoundNumbers(rounded,precision().worldspace);
+			wholeValues[field] = lexical_cast<string>(rounded);
+		}
+		else if (field < CF_MODEL)
+			wholeValues[field] = lexical_cast<string>(val);
+		//strings
+		else if (field == CF_MODEL)
+			wholeValues[field] = boost::get<string>(val);
 		//booleans
-		else if (name == "JustAte" || name == "JustDrank")
+		else if (field == CF_LASTATE || field == CF_LASTDRANK)
 		{
-			if (boost::get<bool>(val))
-			{
-				string newName = "LastAte";
-				if (name == "JustDrank")
-					newName = "LastDrank";
-
-				sqlFields[newName] = "CURRENT_TIMESTAMP";
-			}
+			if (!boost::get<bool>(val))
+				continue;
 		}
 		//addition integeroids
-		else if (name == "KillsZ" || name == "HeadshotsZ" || name == "DistanceFoot" || name == "Duration" ||
-			name == "KillsH" || name == "KillsB" || name == "Humanity")
+		else
 		{
-			int integeroid = static_cast<int>(Sqf::GetDouble(val));
-			char intSign = '+';
-			if (integeroid < 0)
-			{
-				intSign = '-';
-				integeroid = abs(integeroid);
-			}
+			addValues[field] = static_cast<int>(Sqf::GetDouble(val));
+			if (addValues[field] == 0)
+				continue;
+		}
+
+		fieldMask |= (1 << field);
+	}
 
-			if (integeroid > 0) 
-				sqlFields[name] = "(`"+name+"` "+intSign+" "+lexical_cast<string>(integeroid)+")";
+	if (_charCache)
+		_charCache->change(characterId,boost::bind(&ApplyUpdate,_1,boost::cref(fields),precision().worldspace));
+
+	//leave out the fields that would be written with what they already have
+	if (_writeFilter && fieldMask != 0)
+	{
+		for (int i=0; i<NUM_WHOLE_FIELDS; i++)
+		{
+			if ((fieldMask & (1 << i)) == 0)
+				continue;
+
+			if (_writeFilter->isUnchanged(characterId,i,wholeValues[i]))
+				fieldMask &= ~(1 << i);
+			else
+				_writeFilter->written(characterId,i,wholeValues[i]);
 		}
-		//strings
-		else if (name == "Model")
-			sqlFields[name] = "'"+getDB()->escape(boost::get<string>(val))+"'";
+		_writeFilter->countUpdate(fieldMask == 0);
+	}
+
+	if (fieldMask == 0)
+		return true;
+
+	//merged with the other updates of the character until it's written
+	if (_writeCache)
+	{
+		for (int i=0; i<NUM_CHAR_FIELDS; i++)
+		{
+			if ((fieldMask & (1 << i)) == 0)
+				continue;
+
+			if (i < CF_MODEL)
+				_writeCache->set(characterId,static_cast<SqlCharWriteCache::Column>(i),storedLiteral(wholeValues[i]));
+			else if (i == CF_MODEL)
+				_writeCache->set(characterId,SqlCharWriteCache::COL_MODEL,"'"+getDB()->escape(wholeValues[i])+"'");
+			else if (i == CF_LASTATE)
+				_writeCache->ate(characterId);
+			else if (i == CF_LASTDRANK)
+				_writeCache->drank(characterId);
+			else
+				_writeCache->add(characterId,static_cast<SqlCharWriteCache::Counter>(i-CF_KILLSZ),addValues[i]);
+		}
+		return true;
 	}
 
-	if (sqlFields.size() > 0)
+	//every combination of fields gets its own statement, made the first time it's used
+	MaskStatement& maskStmt = _stmtUpdateCharacter[fieldMask];
+	if (maskStmt.sql.empty())
 	{
-		string query = "UPDATE `Character_DATA` SET ";
-		for (auto it=sqlFields.begin();it!=sqlFields.end();)
+		string setList;
+		for (int i=0; i<NUM_CHAR_FIELDS; i++)
 		{
-			string fieldName = it->first;
-			if (fieldName == "Worldspace")
-				fieldName = _wsFieldName;
-
-			query += "`" + fieldName + "` = " + it->second;
-			++it;
-			if (it != sqlFields.end())
-				query += " , ";
+			if ((fieldMask & (1 << i)) == 0)
+				continue;
+
+			if (!setList.empty())
+				setList += " , ";
+
+			string fieldName = (i == CF_WORLDSPACE) ? _wsFieldName : string(CHAR_FIELD_COLUMNS[i]);
+			if (i == CF_LASTATE || i == CF_LASTDRANK)
+				setList += "`" + fieldName + "` = CURRENT_TIMESTAMP";
+			else if (i > CF_LASTDRANK)
+				setList += "`" + fieldName + "` = `" + fieldName + "` + ?";
+			else
+				setList += "`" + fieldName + "` = ?";
 		}
-		query += " WHERE `CharacterID` = " + lexical_cast<string>(characterId);
-		bool exRes = getDB()->execute(query.c_str());
-		poco_assert(exRes == true);
+		maskStmt.sql = "UPDATE `Character_DATA` SET " + setList + " WHERE `CharacterID` = ?";
+	}
 
-		return exRes;
+	auto stmt = getDB()->makeStatement(maskStmt.id, maskStmt.sql);
+	for (int i=0; i<NUM_CHAR_FIELDS; i++)
+	{
+		if ((fieldMask & (1 << i)) == 0)
+			continue;
+
+		if (i < CF_MODEL)
+			bindStored(*stmt,wholeValues[i]);
+		else if (i == CF_MODEL)
+			stmt->addString(wholeValues[i]);
+		else if (i > CF_LASTDRANK)
+			stmt->addInt32(addValues[i]);
 	}
+	stmt->addInt32(characterId);
+
+	bool exRes = stmt->execute();
+	poco_assert(exRes == true);
 
-	return true;
+	return exRes;
 }
 
 bool SqlCharDataSource::initCharacter( int characterId, const Sqf::Value& inventory, const Sqf::Value& backpack )
 {
+	if (_writeFilter)
+		_writeFilter->forget(characterId);
+	if (_charCache)
+	{
+		_charCache->change(characterId,[&](CharacterCache::Character& character)
+			{
+				character.inventory = inventory;
+				character.backpack = backpack;
+			});
+	}
+	//held back updates go before this, not over it
+	if (_writeCache)
+		_writeCache->flush(characterId);
+
 	auto stmt = getDB()->makeStatement(_stmtInitCharacter, "UPDATE `Character_DATA` SET `Inventory` = ? , `Backpack` = ? WHERE `CharacterID` = ?");
-	stmt->addString(lexical_cast<string>(inventory));
-	stmt->addString(lexical_cast<string>(backpack));
+	bindStored(*stmt,inventory);
+	bindStored(*stmt,backpack);
 	stmt->addInt32(characterId);
 	bool exRes = stmt->execute();
 	poco_assert(exRes == true);
@@ -373,6 +810,13 @@ bool SqlCharDataSource::initCharacter( int characterId, const Sqf::Value& invent
 
 bool SqlCharDataSource::killCharacter( int characterId, int duration )
 {
+	if (_writeFilter)
+		_writeFilter->forget(characterId);
+	if (_charCache)
+		_charCache->remove(characterId);
+	if (_writeCache)
+		_writeCache->flush(characterId);
+
 	auto stmt = getDB()->makeStatement(_stmtKillCharacter, 
 		"UPDATE `Character_DATA` SET `Alive` = 0, `LastLogin` = DATE_SUB(CURRENT_TIMESTAMP, INTERVAL ? MINUTE) WHERE `CharacterID` = ? AND `Alive` = 1");
 	stmt->addInt32(duration);
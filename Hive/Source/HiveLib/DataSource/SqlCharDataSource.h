@@ -22,22 +22,55 @@
 #include "CharDataSource.h"
 #include "Database/SqlStatement.h"
 
+#include <boost/unordered_map.hpp>
+
+class WriteFilter;
+class CharacterCache;
+class SqlCharWriteCache;
+class QueryResult;
 class SqlCharDataSource : public SqlDataSource, public CharDataSource
 {
 public:
 	SqlCharDataSource(Poco::Logger& logger, shared_ptr<Database> db, const string& idFieldName, const string& wsFieldName);
 	~SqlCharDataSource();
 
+	//leave out the parts of character updates that would write what was already written
+	void setSkipUnchanged(bool enabled);
+	//stored procedure that does all of a login in one round trip (see SQL/char_login.sql), empty uses separate queries
+	void setLoginProcedure(const string& procName);
+	//keeps up to maxEntries characters in memory for ttlSeconds after they're loaded, 0 entries turns it off
+	void setCache(size_t maxEntries, int ttlSeconds);
+	//loads the alive characters that logged in during the last few hours into the cache
+	void prewarmCache(int hours);
+	//holds back character updates for this many seconds and merges them, 0 writes them right away
+	void setWriteInterval(int seconds);
+
 	Sqf::Value fetchCharacterInitial( string playerId, int serverId, const string& playerName ) override;
 	Sqf::Value fetchCharacterDetails( int characterId ) override;
 	bool updateCharacter( int characterId, const FieldsType& fields ) override;
 	bool initCharacter( int characterId, const Sqf::Value& inventory, const Sqf::Value& backpack ) override;
 	bool killCharacter( int characterId, int duration ) override;
 	bool recordLogin( string playerId, int characterId, int action ) override;
+	void flushWrites() override;
 
 private:
+	//SELECT of everything the cache keeps, without the WHERE
+	string cacheQuery() const;
+	//loads a character into the cache in the background, it's there once the callbacks are invoked
+	void prefetchCharacter(int characterId);
+	//puts the rows of a cacheQuery into the cache, the number of characters that were put in
+	//prewarm rows only fill in characters that aren't cached or being loaded already
+	int cacheRows(QueryResult& res, bool prewarm);
+
 	string _idFieldName;
 	string _wsFieldName;
+	string _loginProcedure;
+	//only there if unchanged updates are skipped
+	unique_ptr<WriteFilter> _writeFilter;
+	//only there if characters are cached, background loads only hold on to it weakly
+	shared_ptr<CharacterCache> _charCache;
+	//only there if updates are held back
+	unique_ptr<SqlCharWriteCache> _writeCache;
 
 	//statement ids
 	SqlStatementID _stmtChangePlayerName;
@@ -47,4 +80,12 @@ private:
 	SqlStatementID _stmtInitCharacter;
 	SqlStatementID _stmtKillCharacter;
 	SqlStatementID _stmtRecordLogin;
+
+	//updates are made with one statement for each combination of fields they have
+	struct MaskStatement
+	{
+		SqlStatementID id;
+		string sql;
+	};
+	boost::unordered_map<UInt32,MaskStatement> _stmtUpdateCharacter;
 };
\ No newline at end of file
@@ -0,0 +1,256 @@
+/*
+* Copyright (C) 2009-2013 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "SqlCharWriteCache.h"
+#include "Database/Database.h"
+#include "Shared/Common/Timer.h"
+
+#include <Poco/Logger.h>
+
+#include <boost/lexical_cast.hpp>
+using boost::lexical_cast;
+
+namespace
+{
+	const char* COLUMN_NAMES[SqlCharWriteCache::NUM_COLUMNS] = { "Worldspace", "Inventory", "Backpack", "Medical", "CurrentState", "Model" };
+	const char* COUNTER_NAMES[SqlCharWriteCache::NUM_COUNTERS] = { "KillsZ", "HeadshotsZ", "DistanceFoot", "Duration", "KillsH", "KillsB", "Humanity" };
+
+	//a statement is cut off at whichever of these comes first
+	const size_t MAX_BATCH_ROWS = 100;
+	const size_t MAX_BATCH_SQL = 512*1024;
+
+	//a held back time, as long ago as it happened
+	string TimeLiteral(Int32 when, Int32 now)
+	{
+		return "DATE_SUB(CURRENT_TIMESTAMP, INTERVAL " + lexical_cast<string>(std::max(now-when,0)) + " SECOND)";
+	}
+};
+
+SqlCharWriteCache::SqlCharWriteCache( Poco::Logger& logger, shared_ptr<Database> db, const string& wsFieldName, long flushIntervalMS )
+	: _logger(logger), _db(db), _wsFieldName(wsFieldName), _flushIntervalMS(flushIntervalMS), 
+	_thread("Character Write Cache"), _isRunning(false), _numSet(0), _numWritten(0)
+{
+}
+
+SqlCharWriteCache::~SqlCharWriteCache()
+{
+	stop();
+}
+
+void SqlCharWriteCache::start()
+{
+	if (_isRunning)
+		return;
+
+	_isRunning = true;
+	_thread.start(*this);
+}
+
+void SqlCharWriteCache::stop()
+{
+	if (_isRunning)
+	{
+		_isRunning = false;	//send stop signal
+		_wakeUp.set();
+		_thread.join();
+	}
+	flush();
+}
+
+void SqlCharWriteCache::run()
+{
+	_db->threadEnter();
+
+	while (_isRunning)
+	{
+		_wakeUp.tryWait(_flushIntervalMS);
+		if (!_isRunning)
+			break;
+
+		flush();
+	}
+
+	_db->threadExit();
+}
+
+void SqlCharWriteCache::set( int characterId, Column col, string literal )
+{
+	Poco::FastMutex::ScopedLock lock(_pendingMutex);
+	_pending[characterId].values[col] = std::move(literal);
+	_numSet++;
+}
+
+void SqlCharWriteCache::add( int characterId, Counter cnt, int amount )
+{
+	Poco::FastMutex::ScopedLock lock(_pendingMutex);
+	_pending[characterId].counters[cnt] += amount;
+	_numSet++;
+}
+
+void SqlCharWriteCache::ate( int characterId )
+{
+	Poco::FastMutex::ScopedLock lock(_pendingMutex);
+	_pending[characterId].ateAt = GlobalTimer::getTime();
+	_numSet++;
+}
+
+void SqlCharWriteCache::drank( int characterId )
+{
+	Poco::FastMutex::ScopedLock lock(_pendingMutex);
+	_pending[characterId].drankAt = GlobalTimer::getTime();
+	_numSet++;
+}
+
+void SqlCharWriteCache::flush()
+{
+	Poco::FastMutex::ScopedLock flushLock(_flushMutex);
+
+	PendingMap toWrite;
+	size_t numSet = 0;
+	{
+		Poco::FastMutex::ScopedLock lock(_pendingMutex);
+		toWrite.swap(_pending);
+		std::swap(numSet,_numSet);
+	}
+	write(toWrite,numSet);
+}
+
+void SqlCharWriteCache::flush( int characterId )
+{
+	Poco::FastMutex::ScopedLock flushLock(_flushMutex);
+
+	PendingMap toWrite;
+	{
+		Poco::FastMutex::ScopedLock lock(_pendingMutex);
+		auto it = _pending.find(characterId);
+		if (it == _pending.end())
+			return;
+
+		toWrite.insert(*it);
+		_pending.erase(it);
+	}
+	write(toWrite,0);
+}
+
+void SqlCharWriteCache::write( const PendingMap& toWrite, size_t numSet )
+{
+	if (toWrite.empty())
+		return;
+
+	auto first = toWrite.begin();
+	size_t numRows = 0;
+	size_t sqlSize = 0;
+	for (auto it=toWrite.begin(); it!=toWrite.end(); ++it)
+	{
+		if (numRows >= MAX_BATCH_ROWS || sqlSize >= MAX_BATCH_SQL)
+		{
+			writeBatch(first,it);
+			first = it;
+			numRows = 0;
+			sqlSize = 0;
+		}
+
+		numRows++;
+		for (size_t col=0; col<NUM_COLUMNS; col++)
+			sqlSize += it->second.values[col].length();
+	}
+	writeBatch(first,toWrite.end());
+
+	_numWritten += toWrite.size();
+	if (numSet > 0)
+	{
+		_logger.debug("Wrote " + lexical_cast<string>(toWrite.size()) + " characters with " + lexical_cast<string>(numSet) + " changes, " + 
+			lexical_cast<string>(_numWritten) + " total");
+	}
+}
+
+void SqlCharWriteCache::writeBatch( PendingMap::const_iterator first, PendingMap::const_iterator last )
+{
+	if (first == last)
+		return;
+
+	const Int32 now = GlobalTimer::getTime();
+	const string keyField = "`CharacterID`";
+
+	//every column that changed for any of the rows, the rest keep what they had
+	vector<string> setList;
+	for (size_t col=0; col<NUM_COLUMNS; col++)
+	{
+		const string colName = "`" + ((col == COL_WORLDSPACE) ? _wsFieldName : string(COLUMN_NAMES[col])) + "`";
+		string caseSql;
+		for (auto it=first; it!=last; ++it)
+		{
+			if (it->second.values[col].empty())
+				continue;
+
+			caseSql += " WHEN " + lexical_cast<string>(it->first) + " THEN " + it->second.values[col];
+		}
+		if (!caseSql.empty())
+			setList.push_back(colName + " = CASE " + keyField + caseSql + " ELSE " + colName + " END");
+	}
+	{
+		string ateSql, drankSql;
+		for (auto it=first; it!=last; ++it)
+		{
+			if (it->second.ateAt != 0)
+				ateSql += " WHEN " + lexical_cast<string>(it->first) + " THEN " + TimeLiteral(it->second.ateAt,now);
+			if (it->second.drankAt != 0)
+				drankSql += " WHEN " + lexical_cast<string>(it->first) + " THEN " + TimeLiteral(it->second.drankAt,now);
+		}
+		if (!ateSql.empty())
+			setList.push_back("`LastAte` = CASE " + keyField + ateSql + " ELSE `LastAte` END");
+		if (!drankSql.empty())
+			setList.push_back("`LastDrank` = CASE " + keyField + drankSql + " ELSE `LastDrank` END");
+	}
+	//counters are added to, so rows that didn't change them add nothing
+	for (size_t cnt=0; cnt<NUM_COUNTERS; cnt++)
+	{
+		const string colName = string("`") + COUNTER_NAMES[cnt] + "`";
+		string caseSql;
+		for (auto it=first; it!=last; ++it)
+		{
+			if (it->second.counters[cnt] == 0)
+				continue;
+
+			caseSql += " WHEN " + lexical_cast<string>(it->first) + " THEN " + lexical_cast<string>(it->second.counters[cnt]);
+		}
+		if (!caseSql.empty())
+			setList.push_back(colName + " = " + colName + " + CASE " + keyField + caseSql + " ELSE 0 END");
+	}
+	if (setList.empty())
+		return;
+
+	string sql = "UPDATE `Character_DATA` SET ";
+	for (auto it=setList.begin(); it!=setList.end(); ++it)
+	{
+		if (it != setList.begin())
+			sql += ", ";
+		sql += *it;
+	}
+	sql += " WHERE " + keyField + " IN (";
+	for (auto it=first; it!=last; ++it)
+	{
+		if (it != first)
+			sql += ",";
+		sql += lexical_cast<string>(it->first);
+	}
+	sql += ")";
+
+	if (!_db->execute(sql.c_str()))
+		_logger.error("Error queueing update of " + lexical_cast<string>(std::distance(first,last)) + " characters");
+}
@@ -0,0 +1,115 @@
+/*
+* Copyright (C) 2009-2013 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "Shared/Common/Types.h"
+
+#include <Poco/Event.h>
+#include <Poco/Mutex.h>
+#include <Poco/Runnable.h>
+#include <Poco/Thread.h>
+
+namespace Poco { class Logger; };
+class Database;
+
+//holds back character updates and merges them, only the latest value of each column and the sum of each counter is kept
+//everything pending is written with a few multi-row UPDATEs, through the same queue the other character writes go through
+class SqlCharWriteCache : public Poco::Runnable
+{
+public:
+	//columns that are written with their latest value
+	enum Column
+	{
+		COL_WORLDSPACE,
+		COL_INVENTORY,
+		COL_BACKPACK,
+		COL_MEDICAL,
+		COL_CURRENTSTATE,
+		COL_MODEL,
+		NUM_COLUMNS
+	};
+	//columns that are added to
+	enum Counter
+	{
+		CNT_KILLSZ,
+		CNT_HEADSHOTSZ,
+		CNT_DISTANCEFOOT,
+		CNT_DURATION,
+		CNT_KILLSH,
+		CNT_KILLSB,
+		CNT_HUMANITY,
+		NUM_COUNTERS
+	};
+
+	SqlCharWriteCache(Poco::Logger& logger, shared_ptr<Database> db, const string& wsFieldName, long flushIntervalMS);
+	~SqlCharWriteCache();
+
+	void start();
+	//writes out what's left
+	void stop();
+	void run() override;
+
+	//literal is the value as it goes into SQL, already quoted or encoded
+	void set(int characterId, Column col, string literal);
+	void add(int characterId, Counter cnt, int amount);
+	//the character just ate or drank, the time is kept so it's written as when it happened
+	void ate(int characterId);
+	void drank(int characterId);
+	//queues all pending changes
+	void flush();
+	//queues the pending changes of one character, before something else is done with it
+	void flush(int characterId);
+private:
+	//empty strings are columns that didn't change, 0 times didn't happen
+	struct PendingCharacter
+	{
+		PendingCharacter() : ateAt(0), drankAt(0) 
+		{
+			for (size_t cnt=0; cnt<NUM_COUNTERS; cnt++)
+				counters[cnt] = 0;
+		}
+
+		string values[NUM_COLUMNS];
+		int counters[NUM_COUNTERS];
+		Int32 ateAt;
+		Int32 drankAt;
+	};
+	typedef map<int,PendingCharacter> PendingMap;
+
+	//queues the pending map in batches
+	void write(const PendingMap& toWrite, size_t numSet);
+	//writes rows [first,last)
+	void writeBatch(PendingMap::const_iterator first, PendingMap::const_iterator last);
+
+	Poco::Logger& _logger;
+	shared_ptr<Database> _db;
+	string _wsFieldName;
+	long _flushIntervalMS;
+
+	Poco::Thread _thread;
+	Poco::Event _wakeUp;
+	volatile bool _isRunning;
+
+	Poco::FastMutex _pendingMutex;
+	PendingMap _pending;
+	//only one flush at a time, so updates are queued in the order they were made
+	Poco::FastMutex _flushMutex;
+	size_t _numSet;
+	size_t _numWritten;
+};
@@ -0,0 +1,95 @@
+/*
+* Copyright (C) 2009-2012 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "SqlDataSource.h"
+#include "Database/Database.h"
+
+#include <boost/lexical_cast.hpp>
+using boost::lexical_cast;
+
+Sqf::Value SqlDataSource::parseStored( const Field& fld ) const
+{
+	if (Sqf::IsBinary(fld.getCStr(),fld.getLength()))
+		return Sqf::DecodeBinary(fld.getCStr(),fld.getLength());
+
+	return lexical_cast<Sqf::Value>(fld.getString());
+}
+
+Sqf::Value SqlDataSource::rawStored( const Field& fld, int decimals ) const
+{
+	const bool isBinary = Sqf::IsBinary(fld.getCStr(),fld.getLength());
+	string sqfText = isBinary ? Sqf::DecodeBinaryText(fld.getCStr(),fld.getLength()) : fld.getString();
+	if (decimals >= 0)
+		sqfText = Sqf::RoundNumbers(sqfText,decimals);
+
+	if (isBinary)
+		return Sqf::RawValue(std::move(sqfText));
+
+	return Sqf::MakeRaw(std::move(sqfText));
+}
+
+bool SqlDataSource::encodeStored( const string& sqfText, ByteVector& out ) const
+{
+	if (!_binaryColumns)
+		return false;
+
+	Sqf::Value val;
+	if (!Sqf::ParseValue(sqfText.c_str(),sqfText.length(),val))
+		return false; //leave anything odd as it is
+
+	out = Sqf::EncodeBinary(val,_binaryCompress);
+	//tiny values like [] stay as text (and keep matching the cleanup queries)
+	return out.size() < sqfText.length();
+}
+
+void SqlDataSource::bindStored( SqlStatement& stmt, const string& sqfText ) const
+{
+	ByteVector bin;
+	if (encodeStored(sqfText,bin))
+		stmt.addBinary(std::move(bin));
+	else
+		stmt.addString(sqfText);
+}
+
+void SqlDataSource::bindStored( SqlStatement& stmt, const Sqf::Value& val ) const
+{
+	bindStored(stmt,lexical_cast<string>(val));
+}
+
+string SqlDataSource::storedLiteral( const Sqf::Value& val ) const
+{
+	return storedLiteral(lexical_cast<string>(val));
+}
+
+string SqlDataSource::storedLiteral( const string& sqfText ) const
+{
+	ByteVector bin;
+	if (!encodeStored(sqfText,bin))
+		return "'"+getDB()->escape(sqfText)+"'";
+
+	static const char hexDigits[] = "0123456789ABCDEF";
+	string literal = "X'";
+	literal.reserve(bin.size()*2+3);
+	for (auto it=bin.begin();it!=bin.end();++it)
+	{
+		literal += hexDigits[*it >> 4];
+		literal += hexDigits[*it & 0x0F];
+	}
+	literal += "'";
+	return literal;
+}
@@ -21,13 +21,48 @@
 #include "DataSource.h"
 
 class Database;
+class Field;
+class SqlStatement;
 class SqlDataSource : public DataSource
 {
 public:
-	SqlDataSource(Poco::Logger& logger, shared_ptr<Database> db) : DataSource(logger), _db(db) {}
+	SqlDataSource(Poco::Logger& logger, shared_ptr<Database> db) : DataSource(logger), _db(db), _binaryColumns(false), _binaryCompress(false) {}
 	~SqlDataSource() {}
+
+	//stored SQF columns are always read in either form, this only affects what gets written
+	void setBinaryColumns(bool enabled, bool compress) { _binaryColumns = enabled; _binaryCompress = compress; }
+
+	//decimal places kept for numbers of these fields, when loading and when saving (negative keeps them as they are)
+	struct Precision
+	{
+		Precision() : worldspace(-1), hitpoints(-1), damage(-1), fuel(-1) {}
+		int worldspace;
+		int hitpoints;
+		int damage;
+		int fuel;
+	};
+	void setPrecision(const Precision& precision) { _precision = precision; }
 protected:
 	Database* getDB() const { return _db.get(); }
+	//for helpers that use the database on their own threads
+	const shared_ptr<Database>& getSharedDB() const { return _db; }
+	const Precision& precision() const { return _precision; }
+
+	//stored SQF columns (text or Sqf::EncodeBinary), these throw bad_lexical_cast on invalid data
+	Sqf::Value parseStored(const Field& fld) const;
+	//for values that are only passed along to the scripts, optionally rounded
+	Sqf::Value rawStored(const Field& fld, int decimals = -1) const;
+	//binds serialized SQF as text or binary, whichever is configured and smaller
+	void bindStored(SqlStatement& stmt, const string& sqfText) const;
+	void bindStored(SqlStatement& stmt, const Sqf::Value& val) const;
+	//quoted SQL literal of the stored form, for queries that are put together by hand
+	string storedLiteral(const Sqf::Value& val) const;
+	string storedLiteral(const string& sqfText) const;
 private:
+	bool encodeStored(const string& sqfText, ByteVector& out) const;
+
 	shared_ptr<Database> _db;
+	bool _binaryColumns;
+	bool _binaryCompress;
+	Precision _precision;
 };
\ No newline at end of file
@@ -0,0 +1,193 @@
+/*
+* Copyright (C) 2009-2013 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "SqlObjChangeFeed.h"
+#include "Database/Database.h"
+
+#include <Poco/Logger.h>
+#include <Poco/NumberParser.h>
+
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_set.hpp>
+#include <boost/lexical_cast.hpp>
+using boost::lexical_cast;
+
+SqlObjChangeFeed::SqlObjChangeFeed( Poco::Logger& logger, shared_ptr<Database> db, const string& tableName, long pollIntervalMS, SerializeFunc serialize )
+	: _logger(logger), _db(db), _tableName(tableName), _pollIntervalMS(pollIntervalMS), _serialize(serialize),
+	_thread("Object Change Feed"), _isRunning(false), _serverId(-1), _lastSeq(0)
+{
+}
+
+SqlObjChangeFeed::~SqlObjChangeFeed()
+{
+	stop();
+}
+
+void SqlObjChangeFeed::start( int serverId, const string& watermark, const vector<int>& ids, const string& text, const vector<size_t>& ends )
+{
+	stop();
+
+	_serverId = serverId;
+	_watermark = watermark;
+	_rowHashes.clear();
+	for (size_t i=0; i<ids.size() && i<ends.size(); i++)
+	{
+		size_t start = (i > 0) ? ends[i-1] : 0;
+		_rowHashes[ids[i]] = boost::hash_range(text.begin()+start,text.begin()+ends[i]);
+	}
+	{
+		//cursors keep counting up, older ones just get everything since the objects were loaded again
+		Poco::FastMutex::ScopedLock lock(_changesMutex);
+		_changes.clear();
+	}
+
+	_isRunning = true;
+	_thread.start(*this);
+}
+
+void SqlObjChangeFeed::stop()
+{
+	if (!_isRunning)
+		return;
+
+	_isRunning = false;	//send stop signal
+	_wakeUp.set();
+	_thread.join();		//wait for current poll to finish
+}
+
+void SqlObjChangeFeed::run()
+{
+	_db->threadEnter();
+
+	while (_isRunning)
+	{
+		_wakeUp.tryWait(_pollIntervalMS);
+		if (!_isRunning)
+			break;
+
+		poll();
+	}
+
+	_db->threadExit();
+}
+
+void SqlObjChangeFeed::poll()
+{
+	string now;
+	{
+		auto nowRes = _db->query("SELECT CURRENT_TIMESTAMP");
+		if (!nowRes || !nowRes->fetchRow())
+			return;
+
+		now = nowRes->at(0).getString();
+	}
+
+	//rows updated in the same second as the watermark get fetched again, the hashes keep them from counting twice
+	//ObjectUID comes last, so the rest of the row is what the serializer expects
+	auto changedRes = _db->queryParams("SELECT `ObjectID`, `Classname`, `CharacterID`, `Worldspace`, `Inventory`, `Hitpoints`, `Fuel`, `Damage`, `ObjectUID` FROM `%s` "
+		"WHERE `Instance`=%d AND `Classname` IS NOT NULL AND `last_updated` >= '%s'", _tableName.c_str(), _serverId, _db->escape(_watermark).c_str());
+	if (!changedRes)
+	{
+		_logger.error("Failed to fetch changed objects");
+		return;
+	}
+
+	size_t numChanged = 0;
+	while (changedRes->fetchRow())
+	{
+		const vector<Field>& row = changedRes->fields();
+		string rowText;
+		if (!_serialize(&row[0],rowText))
+			continue;
+
+		int objectId = row[0].getInt32();
+		size_t rowHash = boost::hash_range(rowText.begin(),rowText.end());
+		auto hashIt = _rowHashes.find(objectId);
+		if (hashIt != _rowHashes.end() && hashIt->second == rowHash)
+			continue;
+
+		_rowHashes[objectId] = rowHash;
+		Int64 uniqueId = 0;
+		if (row[8].isNull() || !Poco::NumberParser::tryParse64(row[8].getString(),uniqueId))
+			uniqueId = 0;
+
+		record(objectId,false,std::move(rowText),uniqueId);
+		numChanged++;
+	}
+
+	//anything known that isn't there anymore was deleted
+	auto idsRes = _db->queryParams("SELECT `ObjectID` FROM `%s` WHERE `Instance`=%d AND `Classname` IS NOT NULL", _tableName.c_str(), _serverId);
+	if (!idsRes)
+	{
+		_logger.error("Failed to fetch object ids");
+		return;
+	}
+
+	boost::unordered_set<int> presentIds;
+	presentIds.rehash(_rowHashes.size());
+	while (idsRes->fetchRow())
+		presentIds.insert(idsRes->at(0).getInt32());
+
+	size_t numDeleted = 0;
+	for (auto it=_rowHashes.begin(); it!=_rowHashes.end();)
+	{
+		if (presentIds.count(it->first))
+		{
+			++it;
+			continue;
+		}
+
+		record(it->first,true,string());
+		it = _rowHashes.erase(it);
+		numDeleted++;
+	}
+
+	_watermark = now;
+	if (numChanged > 0 || numDeleted > 0)
+		_logger.debug("Object changes: " + lexical_cast<string>(numChanged) + " changed, " + lexical_cast<string>(numDeleted) + " deleted");
+}
+
+void SqlObjChangeFeed::record( int objectId, bool deleted, string row, Int64 uniqueId )
+{
+	Poco::FastMutex::ScopedLock lock(_changesMutex);
+	Change& change = _changes[objectId];
+	change.seq = ++_lastSeq;
+	change.deleted = deleted;
+	change.row = std::move(row);
+	change.uniqueId = uniqueId;
+}
+
+void SqlObjChangeFeed::changesSince( UInt32& cursor, vector<string>& rows, vector<int>& objectIds, vector<Int64>& uniqueIds, vector<int>& deletedIds )
+{
+	Poco::FastMutex::ScopedLock lock(_changesMutex);
+	for (auto it=_changes.begin(); it!=_changes.end(); ++it)
+	{
+		if (it->second.seq <= cursor)
+			continue;
+
+		if (it->second.deleted)
+			deletedIds.push_back(it->first);
+		else
+		{
+			rows.push_back(it->second.row);
+			objectIds.push_back(it->first);
+			uniqueIds.push_back(it->second.uniqueId);
+		}
+	}
+	cursor = _lastSeq;
+}
@@ -0,0 +1,85 @@
+/*
+* Copyright (C) 2009-2013 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "Shared/Common/Types.h"
+#include "HiveLib/Sqf.h"
+
+#include <boost/function.hpp>
+#include <Poco/Event.h>
+#include <Poco/Mutex.h>
+#include <Poco/Runnable.h>
+#include <Poco/Thread.h>
+
+namespace Poco { class Logger; };
+class Database;
+class Field;
+
+//follows the objects of an instance in the database after they were loaded, so changes made by others can be picked up
+//every poll fetches the rows whose last_updated moved on since the previous one, and finds deleted ones by their ObjectID being gone
+//only the latest state of every object is kept, numbered by the poll it was seen in
+class SqlObjChangeFeed : public Poco::Runnable
+{
+public:
+	//fills in the stream row of a fetched object row, false if it has invalid data
+	typedef boost::function<bool (const Field* row, string& out)> SerializeFunc;
+
+	SqlObjChangeFeed(Poco::Logger& logger, shared_ptr<Database> db, const string& tableName, long pollIntervalMS, SerializeFunc serialize);
+	~SqlObjChangeFeed();
+
+	//follows serverId from the objects that were just loaded, watermark is the database time loading started at
+	//rows are the loaded stream rows, like ServerObjectsQueue has them
+	void start(int serverId, const string& watermark, const vector<int>& ids, const string& text, const vector<size_t>& ends);
+	void stop();
+	void run() override;
+
+	//objects changed or deleted after cursor, cursor becomes what to ask with next time
+	//objectIds and uniqueIds have the ObjectID and ObjectUID of every row (0 if it has none)
+	void changesSince(UInt32& cursor, vector<string>& rows, vector<int>& objectIds, vector<Int64>& uniqueIds, vector<int>& deletedIds);
+private:
+	void poll();
+	//records a change if the object isn't already like that
+	void record(int objectId, bool deleted, string row, Int64 uniqueId = 0);
+
+	Poco::Logger& _logger;
+	shared_ptr<Database> _db;
+	string _tableName;
+	long _pollIntervalMS;
+	SerializeFunc _serialize;
+
+	Poco::Thread _thread;
+	Poco::Event _wakeUp;
+	volatile bool _isRunning;
+
+	int _serverId;
+	string _watermark;
+	//hashes of the rows as they last were, by ObjectID
+	unordered_map<int,size_t> _rowHashes;
+
+	struct Change
+	{
+		UInt32 seq;
+		bool deleted;
+		string row;
+		Int64 uniqueId;
+	};
+	Poco::FastMutex _changesMutex;
+	map<int,Change> _changes;
+	UInt32 _lastSeq;
+};
@@ -0,0 +1,153 @@
+/*
+* Copyright (C) 2009-2013 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "SqlObjCleaner.h"
+#include "Database/Database.h"
+
+#include <Poco/Logger.h>
+
+#include <boost/lexical_cast.hpp>
+using boost::lexical_cast;
+
+namespace
+{
+	//how many batches go by between progress messages
+	const size_t PROGRESS_BATCHES = 10;
+};
+
+SqlObjCleaner::SqlObjCleaner(Poco::Logger& logger, shared_ptr<Database> db, const string& tableName, 
+	int olderThanDays, size_t batchSize, long batchDelayMS) 
+	: _logger(logger), _db(db), _tableName(tableName), _olderThanDays(olderThanDays), _batchSize(batchSize), _batchDelayMS(batchDelayMS),
+	_thread("Object Cleanup"), _isRunning(false), _serverId(-1), _lastKey(0), _numRemoved(0)
+{
+	if (_batchSize < 1)
+		_batchSize = 1;
+	if (_batchDelayMS < 0)
+		_batchDelayMS = 0;
+}
+
+SqlObjCleaner::~SqlObjCleaner()
+{
+	stop();
+}
+
+void SqlObjCleaner::start( int serverId )
+{
+	if (_isRunning && _thread.isRunning())
+		return;
+
+	stop();
+
+	_serverId = serverId;
+	_conditionSql = "`Instance` = " + lexical_cast<string>(_serverId) + " AND " + staleSql();
+	_lastKey = 0;
+	_numRemoved = 0;
+
+	_isRunning = true;
+	_thread.start(*this);
+}
+
+string SqlObjCleaner::staleSql() const
+{
+	return "`ObjectUID` <> 0 AND `CharacterID` <> 0"
+		" AND `Datestamp` < DATE_SUB(CURRENT_TIMESTAMP, INTERVAL "+lexical_cast<string>(_olderThanDays)+" DAY)"
+		" AND ( (`Inventory` IS NULL) OR (`Inventory` = '[]') )";
+}
+
+void SqlObjCleaner::stop()
+{
+	if (!_isRunning)
+		return;
+
+	_isRunning = false;	//send stop signal
+	_thread.join();		//wait for current batch to finish
+}
+
+void SqlObjCleaner::run()
+{
+	_db->threadEnter();
+
+	int numToRemove = 0;
+	{
+		auto countRes = _db->query(("SELECT COUNT(*) FROM `" + _tableName + "` WHERE " + _conditionSql).c_str());
+		if (countRes && countRes->fetchRow())
+			numToRemove = countRes->at(0).getInt32();
+	}
+
+	if (numToRemove > 0)
+	{
+		_logger.information("Removing " + lexical_cast<string>(numToRemove) + " empty placed objects older than " + lexical_cast<string>(_olderThanDays) + 
+			" days in batches of " + lexical_cast<string>(_batchSize));
+
+		bool finished = false;
+		size_t numBatches = 0;
+		while (_isRunning)
+		{
+			if (!cleanupBatch())
+			{
+				finished = true;
+				break;
+			}
+			if (++numBatches % PROGRESS_BATCHES == 0)
+				_logger.information("Removed " + lexical_cast<string>(_numRemoved) + " of " + lexical_cast<string>(numToRemove) + " empty placed objects");
+
+			Poco::Thread::sleep(_batchDelayMS);
+		}
+		if (finished)
+			_logger.information("Finished removing empty placed objects, " + lexical_cast<string>(_numRemoved) + " removed");
+		else
+			_logger.information("Stopped removing empty placed objects at ObjectID " + lexical_cast<string>(_lastKey) + ", " + lexical_cast<string>(_numRemoved) + " removed");
+	}
+
+	_db->threadExit();
+}
+
+bool SqlObjCleaner::cleanupBatch()
+{
+	auto batchRes = _db->query(("SELECT `ObjectID` FROM `" + _tableName + "` WHERE " + _conditionSql + 
+		" AND `ObjectID` > " + lexical_cast<string>(_lastKey) + " ORDER BY `ObjectID` LIMIT " + lexical_cast<string>(_batchSize)).c_str());
+	if (!batchRes)
+	{
+		_logger.error("Failed to fetch empty placed objects for removal");
+		return false;
+	}
+
+	string idList;
+	size_t numRows = 0;
+	while (batchRes->fetchRow())
+	{
+		_lastKey = batchRes->at(0).getUInt64();
+		if (!idList.empty())
+			idList += ",";
+		idList += lexical_cast<string>(_lastKey);
+		numRows++;
+	}
+	if (numRows < 1)
+		return false;
+
+	//the conditions are checked again, something might have been put into an object since it was selected
+	string sql = "DELETE FROM `" + _tableName + "` WHERE `ObjectID` IN (" + idList + ") AND " + _conditionSql;
+	if (!_db->directExecute(sql.c_str()))
+	{
+		_logger.error("Error executing placed objects cleanup statement");
+		return false;
+	}
+	_numRemoved += numRows;
+
+	return (numRows >= _batchSize);
+}
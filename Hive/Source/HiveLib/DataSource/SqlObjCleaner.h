@@ -0,0 +1,63 @@
+/*
+* Copyright (C) 2009-2013 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "Shared/Common/Types.h"
+
+#include <Poco/Runnable.h>
+#include <Poco/Thread.h>
+
+namespace Poco { class Logger; };
+class Database;
+
+//removes empty placed objects that haven't been touched for a while, in the background
+//rows are deleted in ObjectID order, a batch at a time with a pause after each, so the table is never locked for long
+class SqlObjCleaner : public Poco::Runnable
+{
+public:
+	SqlObjCleaner(Poco::Logger& logger, shared_ptr<Database> db, const string& tableName, 
+		int olderThanDays, size_t batchSize, long batchDelayMS);
+	~SqlObjCleaner();
+
+	//does nothing if it's still cleaning up after an earlier start
+	void start(int serverId);
+	void stop();
+	void run() override;
+
+	//the conditions an object has to match to be removed, apart from its instance
+	string staleSql() const;
+private:
+	//false once there is nothing more to remove
+	bool cleanupBatch();
+
+	Poco::Logger& _logger;
+	shared_ptr<Database> _db;
+	string _tableName;
+	int _olderThanDays;
+	size_t _batchSize;
+	long _batchDelayMS;
+
+	Poco::Thread _thread;
+	volatile bool _isRunning;
+	int _serverId;
+	//the WHERE conditions an object has to match to be removed
+	string _conditionSql;
+	UInt64 _lastKey;
+	size_t _numRemoved;
+};
@@ -17,8 +17,14 @@
 */
 
 #include "SqlObjDataSource.h"
+#include "ObjectSnapshot.h"
+#include "SqlObjCleaner.h"
+#include "SqlObjWriteCache.h"
+#include "SqlObjChangeFeed.h"
+#include "WriteFilter.h"
 #include "Database/Database.h"
 
+#include <boost/bind.hpp>
 #include <boost/format.hpp>
 #include <boost/lexical_cast.hpp>
 using boost::lexical_cast;
@@ -69,6 +75,34 @@ namespace
 	};
 
 	PositionInfo FixOOBWorldspace(Sqf::Value& v) { return boost::apply_visitor(WorldspaceFixerVisitor(),v); }
+
+	//[dir,[x,y,z]], z is 0 if the position doesn't have it
+	bool ReadWorldspacePosition(const string& worldspace, double& x, double& y, double& z)
+	{
+		Sqf::Document doc;
+		if (!doc.parseValue(worldspace.c_str(),worldspace.length()))
+			return false;
+
+		size_t wsNode = doc.root();
+		if (doc.type(wsNode) != Sqf::Document::TYPE_ARRAY || doc.size(wsNode) != 2)
+			return false;
+
+		size_t posNode = doc.child(wsNode,1);
+		if (doc.type(posNode) != Sqf::Document::TYPE_ARRAY || doc.size(posNode) < 2)
+			return false;
+
+		try
+		{
+			x = doc.getDouble(doc.child(posNode,0));
+			y = doc.getDouble(doc.child(posNode,1));
+			z = (doc.size(posNode) > 2) ? doc.getDouble(doc.child(posNode,2)) : 0;
+		}
+		catch (const boost::bad_get&)
+		{
+			return false;
+		}
+		return true;
+	}
 };
 
 #include <Poco/Util/AbstractConfiguration.h>
@@ -80,101 +114,457 @@ SqlObjDataSource::SqlObjDataSource( Poco::Logger& logger, shared_ptr<Database> d
 		_objTableName = getDB()->escape(conf->getString("Table",defaultTable));
 		_cleanupPlacedDays = conf->getInt("CleanupPlacedAfterDays",6);
 		_vehicleOOBReset = conf->getBool("ResetOOBVehicles",false);
+		_loadThreads = conf->getInt("LoadThreads",0);
+		_snapshotFile = conf->getString("SnapshotFile","");
+		_idBlockSize = conf->getInt("IDBlockSize",0);
+		_moveDeadband = conf->getDouble("MoveDeadband",0);
+
+		if (conf->getBool("SkipUnchangedWrites",false))
+			_writeFilter.reset(new WriteFilter(_logger,"object",SqlObjWriteCache::NUM_COLUMNS));
+
+		int writeInterval = conf->getInt("WriteInterval",0);
+		if (writeInterval > 0)
+			_writeCache.reset(new SqlObjWriteCache(_logger,db,_objTableName,writeInterval*1000L));
+
+		int pollInterval = conf->getInt("ChangePollInterval",0);
+		if (pollInterval > 0)
+		{
+			_changeFeed.reset(new SqlObjChangeFeed(_logger,db,_objTableName,pollInterval*1000L,
+				boost::bind(&SqlObjDataSource::serializeObject,this,_1,_2)));
+		}
+
+		if (_cleanupPlacedDays >= 0)
+		{
+			_cleaner.reset(new SqlObjCleaner(_logger,db,_objTableName,_cleanupPlacedDays,
+				conf->getInt("CleanupBatch",100),conf->getInt("CleanupBatchDelay",250)));
+		}
 	}
 	else
 	{
 		_objTableName = defaultTable;
 		_cleanupPlacedDays = -1;
 		_vehicleOOBReset = false;
+		_loadThreads = 0;
+		_idBlockSize = 0;
+		_moveDeadband = 0;
 	}
+
+	_loadedServerId = -1;
+	_nextObjectId = 0;
+	_objectIdBlockEnd = 0;
 }
 
-void SqlObjDataSource::populateObjects( int serverId, ServerObjectsQueue& queue )
+//the background threads are stopped when their owners go away, held back updates are written when _writeCache does
+SqlObjDataSource::~SqlObjDataSource() {}
+
+#include <Poco/Environment.h>
+#include <Poco/Notification.h>
+#include <Poco/NotificationQueue.h>
+#include <Poco/Runnable.h>
+#include <Poco/Thread.h>
+
+namespace
+{
+	const size_t NUM_OBJECT_FIELDS = 8;
+	const size_t OBJECT_BATCH_ROWS = 256;
+};
+
+//the fields point into the stored result, which stays alive until loading is done
+//each batch gets its own output, so the rows can be put together in their original order
+class SqlObjDataSource::ObjectBatch : public Poco::Notification
+{
+public:
+	vector<Field> fields;
+	string text;
+	vector<size_t> ends;
+	vector<int> ids;
+	//something other than invalid data got in the way, the batch is missing rows
+	bool failed;
+
+	ObjectBatch() : failed(false) {}
+};
+
+class SqlObjDataSource::LoadWorker : public Poco::Runnable
 {
-	if (_cleanupPlacedDays >= 0)
+public:
+	LoadWorker(const SqlObjDataSource& source, Poco::NotificationQueue& queue) : _source(source), _queue(queue) {}
+
+	//runs until it gets a notification that isn't a batch
+	void run() override
 	{
-		string commonSql = "FROM `"+_objTableName+"` WHERE `Instance` = " + lexical_cast<string>(serverId) +
-			" AND `ObjectUID` <> 0 AND `CharacterID` <> 0" +
-			" AND `Datestamp` < DATE_SUB(CURRENT_TIMESTAMP, INTERVAL "+lexical_cast<string>(_cleanupPlacedDays)+" DAY)" +
-			" AND ( (`Inventory` IS NULL) OR (`Inventory` = '[]') )";
+		for (;;)
+		{
+			Poco::AutoPtr<Poco::Notification> note(_queue.waitDequeueNotification());
+			ObjectBatch* batch = dynamic_cast<ObjectBatch*>(note.get());
+			if (!batch)
+				break;
+
+			//the worker keeps going after a failure, so the remaining batches don't get stuck in the queue
+			for (size_t i=0; i+NUM_OBJECT_FIELDS<=batch->fields.size(); i+=NUM_OBJECT_FIELDS)
+			{
+				const size_t rowStart = batch->text.length();
+				try
+				{
+					if (_source.serializeObject(&batch->fields[i],batch->text))
+					{
+						batch->ends.push_back(batch->text.length());
+						batch->ids.push_back(batch->fields[i].getInt32());
+					}
+				}
+				catch (const std::exception& e)
+				{
+					batch->text.resize(rowStart);
+					batch->failed = true;
+					_source._logger.error("Failed to load ObjectID " + lexical_cast<string>(batch->fields[i].getInt32()) + ": " + e.what());
+				}
+			}
+		}
+	}
+private:
+	const SqlObjDataSource& _source;
+	Poco::NotificationQueue& _queue;
+};
+
+bool SqlObjDataSource::populateObjects( int serverId, ServerObjectsQueue& queue )
+{
+	_loadedServerId = -1;
+	_loadedWatermark.clear();
+	LoadedObjects().swap(_loadedObjects);
+
+	//taken before the rows are read, so anything changed while loading gets fetched again next time
+	string watermark;
+	if (!_snapshotFile.empty() || _changeFeed)
+	{
+		auto nowRes = getDB()->query("SELECT CURRENT_TIMESTAMP");
+		if (nowRes && nowRes->fetchRow())
+			watermark = nowRes->at(0).getString();
+	}
 
-		int numCleaned = 0;
+	ObjectSnapshot snapshot;
+	bool incremental = !watermark.empty() && !_snapshotFile.empty() && snapshot.open(_snapshotFile,serverId,snapshotSettings());
+	//rows updated in the same second as the watermark might not be in the snapshot yet, so those get fetched too
+	string changedSql = loadFilterSql();
+	if (incremental)
+		changedSql += " AND `last_updated` >= '" + getDB()->escape(snapshot.watermark()) + "'";
+
+	LoadedObjects loaded;
+	boost::unordered_set<int> fetchedIds;
+	{
+		auto worldObjsRes = getDB()->queryParams("SELECT `ObjectID`, `Classname`, `CharacterID`, `Worldspace`, `Inventory`, `Hitpoints`, `Fuel`, `Damage` FROM `%s` WHERE `Instance`=%d AND `Classname` IS NOT NULL%s", 
+			_objTableName.c_str(), serverId, changedSql.c_str());
+		if (!worldObjsRes)
 		{
-			auto numObjsToClean = getDB()->query(("SELECT COUNT(*) "+commonSql).c_str());
-			if (numObjsToClean && numObjsToClean->fetchRow())
-				numCleaned = numObjsToClean->at(0).getInt32();
+			_logger.error("Failed to fetch objects from database");
+			return false;
 		}
-		if (numCleaned > 0)
+		if (!loadObjects(*worldObjsRes,loaded,incremental ? &fetchedIds : nullptr))
 		{
-			_logger.information("Removing " + lexical_cast<string>(numCleaned) + " empty placed objects older than " + lexical_cast<string>(_cleanupPlacedDays) + " days");
+			_logger.error("Failed to load all objects from database");
+			return false;
+		}
+	}
 
-			auto stmt = getDB()->makeStatement(_stmtDeleteOldObject, "DELETE "+commonSql);
-			if (!stmt->directExecute())
-				_logger.error("Error executing placed objects cleanup statement");
+	if (incremental)
+	{
+		size_t numChanged = loaded.ids.size();
+		size_t numSnapshot = snapshot.rows().size();
+		if (!mergeSnapshot(serverId,snapshot,fetchedIds,loaded))
+		{
+			_logger.error("Failed to merge object snapshot with the database");
+			return false;
 		}
+		_logger.information("Used object snapshot from " + snapshot.watermark() + " with " + lexical_cast<string>(numSnapshot) + " objects, " + 
+			lexical_cast<string>(numChanged) + " changed since then");
 	}
-	
-	auto worldObjsRes = getDB()->queryParams("SELECT `ObjectID`, `Classname`, `CharacterID`, `Worldspace`, `Inventory`, `Hitpoints`, `Fuel`, `Damage` FROM `%s` WHERE `Instance`=%d AND `Classname` IS NOT NULL", _objTableName.c_str(), serverId);
-	if (!worldObjsRes)
+	snapshot.close();
+
+	queue.append(loaded.text,loaded.ends);
+	_logger.information("Loaded " + lexical_cast<string>(loaded.ids.size()) + " objects");
+
+	//nothing that depends on the instance is started until it's known these are the objects being used
+	_loadedServerId = serverId;
+	if (!watermark.empty())
 	{
-		_logger.error("Failed to fetch objects from database");
-		return;
+		_loadedWatermark = watermark;
+		_loadedObjects.swap(loaded);
 	}
-	while (worldObjsRes->fetchRow())
+	return true;
+}
+
+void SqlObjDataSource::useLoadedObjects( int serverId )
+{
+	//the objects start out as they are in the database
+	if (_writeFilter)
+		_writeFilter->clear();
+
+	if (serverId == _loadedServerId && !_loadedWatermark.empty())
 	{
-		auto row = worldObjsRes->fields();
+		const LoadedObjects& loaded = _loadedObjects;
+		if (!_snapshotFile.empty())
+		{
+			if (!ObjectSnapshot::Write(_snapshotFile,serverId,snapshotSettings(),_loadedWatermark,loaded.ids,loaded.text,loaded.ends))
+				_logger.warning("Failed to write object snapshot to " + _snapshotFile);
+		}
+		if (_changeFeed)
+			_changeFeed->start(serverId,_loadedWatermark,loaded.ids,loaded.text,loaded.ends);
+	}
+	_loadedServerId = -1;
+	_loadedWatermark.clear();
+	LoadedObjects().swap(_loadedObjects);
+
+	//old placed objects are removed after loading, on their own thread, they were already left out of it
+	if (_cleaner)
+		_cleaner->start(serverId);
+	if (_writeCache)
+		_writeCache->start();
+}
 
-		Sqf::Parameters objParams;
-		objParams.push_back(string("OBJ"));
+bool SqlObjDataSource::loadObjects( QueryResult& res, LoadedObjects& out, boost::unordered_set<int>* fetchedIds )
+{
+	//rows are handed out to the workers while they are still being fetched
+	size_t numThreads = (_loadThreads > 0) ? _loadThreads : Poco::Environment::processorCount();
+	if (numThreads < 1)
+		numThreads = 1;
+
+	Poco::NotificationQueue batchQueue;
+	vector<shared_ptr<LoadWorker>> workers;
+	vector<shared_ptr<Poco::Thread>> threads;
+	for (size_t i=0; i<numThreads; i++)
+	{
+		workers.push_back(boost::make_shared<LoadWorker>(*this,batchQueue));
+		threads.push_back(boost::make_shared<Poco::Thread>());
+		threads.back()->start(*workers.back());
+	}
 
-		int objectId = row[0].getInt32();
-		objParams.push_back(lexical_cast<string>(objectId)); //objectId should be stringified
-		try
+	vector<Poco::AutoPtr<ObjectBatch>> batches;
+	Poco::AutoPtr<ObjectBatch> currBatch;
+	while (res.fetchRow())
+	{
+		if (currBatch.isNull())
 		{
-			objParams.push_back(row[1].getString()); //classname
-			objParams.push_back(lexical_cast<string>(row[2].getInt32())); //ownerId should be stringified
+			currBatch = new ObjectBatch();
+			currBatch->fields.reserve(OBJECT_BATCH_ROWS*NUM_OBJECT_FIELDS);
+		}
 
-			Sqf::Value worldSpace = lexical_cast<Sqf::Value>(row[3].getString());
-			if (_vehicleOOBReset && row[2].getInt32() == 0) // no owner = vehicle
-			{
-				PositionInfo posInfo = FixOOBWorldspace(worldSpace);
-				if (posInfo.is_initialized())
-					_logger.information("Reset ObjectID " + lexical_cast<string>(objectId) + " (" + row[1].getString() + ") from position " + lexical_cast<string>(*posInfo));
+		const vector<Field>& row = res.fields();
+		if (fetchedIds)
+			fetchedIds->insert(row[0].getInt32());
 
-			}			
-			objParams.push_back(worldSpace);
+		currBatch->fields.insert(currBatch->fields.end(),row.begin(),row.begin()+NUM_OBJECT_FIELDS);
+		if (currBatch->fields.size() >= OBJECT_BATCH_ROWS*NUM_OBJECT_FIELDS)
+		{
+			batches.push_back(currBatch);
+			batchQueue.enqueueNotification(currBatch);
+			currBatch = Poco::AutoPtr<ObjectBatch>();
+		}
+	}
+	if (!currBatch.isNull())
+	{
+		batches.push_back(currBatch);
+		batchQueue.enqueueNotification(currBatch);
+	}
+
+	//one end marker for each worker, after all the batches
+	for (size_t i=0; i<numThreads; i++)
+		batchQueue.enqueueNotification(new Poco::Notification());
+	for (size_t i=0; i<numThreads; i++)
+		threads[i]->join();
+
+	size_t numLoaded = 0;
+	bool failed = false;
+	for (auto it=batches.begin(); it!=batches.end(); ++it)
+	{
+		failed = failed || (*it)->failed;
+		size_t offset = out.text.length();
+		out.text += (*it)->text;
+		for (auto endIt=(*it)->ends.begin(); endIt!=(*it)->ends.end(); ++endIt)
+			out.ends.push_back(offset + *endIt);
+		out.ids.insert(out.ids.end(),(*it)->ids.begin(),(*it)->ids.end());
+		numLoaded += (*it)->ends.size();
+	}
+
+	_logger.information("Serialized " + lexical_cast<string>(numLoaded) + " objects using " + lexical_cast<string>(numThreads) + " threads");
+	return !failed;
+}
 
-			//Inventory can be NULL
+namespace
+{
+	const size_t MAX_REFETCH_IDS = 1000;
+};
+
+bool SqlObjDataSource::mergeSnapshot( int serverId, const ObjectSnapshot& snapshot, const boost::unordered_set<int>& fetchedIds, LoadedObjects& changed )
+{
+	//ids that aren't in the database anymore are the objects deleted since the snapshot was made
+	auto idsRes = getDB()->queryParams("SELECT `ObjectID` FROM `%s` WHERE `Instance`=%d AND `Classname` IS NOT NULL%s ORDER BY `ObjectID`", 
+		_objTableName.c_str(), serverId, loadFilterSql().c_str());
+	if (!idsRes)
+		return false;
+
+	unordered_map<int,size_t> changedRows;
+	for (size_t i=0; i<changed.ids.size(); i++)
+		changedRows[changed.ids[i]] = i;
+
+	LoadedObjects merged;
+	merged.text.reserve(changed.text.length());
+	vector<int> missingIds;
+	size_t numRemaining = 0;
+	while (idsRes->fetchRow())
+	{
+		int objectId = idsRes->at(0).getInt32();
+		auto snapIt = snapshot.rows().find(objectId);
+		if (snapIt != snapshot.rows().end())
+			numRemaining++;
+
+		const char* text = nullptr;
+		size_t length = 0;
+		if (fetchedIds.count(objectId))
+		{
+			//was fetched, but could have been skipped because of invalid data
+			auto it = changedRows.find(objectId);
+			if (it == changedRows.end())
+				continue;
+
+			size_t start = (it->second > 0) ? changed.ends[it->second-1] : 0;
+			text = changed.text.data()+start;
+			length = changed.ends[it->second]-start;
+		}
+		else
+		{
+			if (snapIt == snapshot.rows().end())
 			{
-				string invStr = "[]";
-				if (!row[4].isNull())
-					invStr = row[4].getString();
+				//not changed recently, but the snapshot doesn't have it either (it had invalid data then, or the snapshot is older than the table)
+				missingIds.push_back(objectId);
+				continue;
+			}
 
-				objParams.push_back(lexical_cast<Sqf::Value>(invStr));
-			}	
-			objParams.push_back(lexical_cast<Sqf::Value>(row[5].getCStr()));
-			objParams.push_back(row[6].getDouble());
-			objParams.push_back(row[7].getDouble());
+			text = snapIt->second.text;
+			length = snapIt->second.length;
 		}
-		catch (const bad_lexical_cast&)
+
+		merged.text.append(text,length);
+		merged.ends.push_back(merged.text.length());
+		merged.ids.push_back(objectId);
+	}
+
+	size_t numDeleted = snapshot.rows().size()-numRemaining;
+	for (size_t i=0; i<missingIds.size(); i+=MAX_REFETCH_IDS)
+	{
+		string idList;
+		for (size_t j=i; j<missingIds.size() && j<i+MAX_REFETCH_IDS; j++)
 		{
-			_logger.error("Skipping ObjectID " + lexical_cast<string>(objectId) + " load because of invalid data in db");
-			continue;
+			if (!idList.empty())
+				idList += ",";
+			idList += lexical_cast<string>(missingIds[j]);
 		}
 
-		queue.push(objParams);
+		auto missingRes = getDB()->queryParams("SELECT `ObjectID`, `Classname`, `CharacterID`, `Worldspace`, `Inventory`, `Hitpoints`, `Fuel`, `Damage` FROM `%s` WHERE `Instance`=%d AND `ObjectID` IN (%s)", 
+			_objTableName.c_str(), serverId, idList.c_str());
+		if (!missingRes || !loadObjects(*missingRes,merged,nullptr))
+			return false;
+	}
+
+	if (numDeleted > 0 || !missingIds.empty())
+	{
+		_logger.information(lexical_cast<string>(numDeleted) + " snapshot objects were deleted, " + 
+			lexical_cast<string>(missingIds.size()) + " objects were missing from it");
+	}
+
+	changed.swap(merged);
+	return true;
+}
+
+string SqlObjDataSource::snapshotSettings() const
+{
+	return str(boost::format("ws=%d;hp=%d;dmg=%d;fuel=%d;oob=%d;fmt=%d") 
+		% precision().worldspace % precision().hitpoints % precision().damage % precision().fuel 
+		% _vehicleOOBReset % Sqf::GetNumberFormat());
+}
+
+string SqlObjDataSource::loadFilterSql() const
+{
+	if (!_cleaner)
+		return "";
+
+	//IS NOT TRUE keeps the rows the conditions come out NULL for, the cleaner leaves those alone as well
+	return " AND (" + _cleaner->staleSql() + ") IS NOT TRUE";
+}
+
+bool SqlObjDataSource::serializeObject( const Field* row, string& out ) const
+{
+	Sqf::Parameters objParams;
+	objParams.push_back(string("OBJ"));
+
+	int objectId = row[0].getInt32();
+	objParams.push_back(lexical_cast<string>(objectId)); //objectId should be stringified
+	try
+	{
+		objParams.push_back(row[1].getString()); //classname
+		objParams.push_back(lexical_cast<string>(row[2].getInt32())); //ownerId should be stringified
+
+		//only needs to be looked at if it might get reset
+		Sqf::Value worldSpace;
+		if (_vehicleOOBReset && row[2].getInt32() == 0) // no owner = vehicle
+		{
+			worldSpace = parseStored(row[3]);
+			Sqf::RoundNumbers(worldSpace,precision().worldspace);
+			PositionInfo posInfo = FixOOBWorldspace(worldSpace);
+			if (posInfo.is_initialized())
+				_logger.information("Reset ObjectID " + lexical_cast<string>(objectId) + " (" + row[1].getString() + ") from position " + lexical_cast<string>(*posInfo));
+
+		}
+		else
+			worldSpace = rawStored(row[3],precision().worldspace);
+		objParams.push_back(worldSpace);
+
+		//Inventory can be NULL
+		if (!row[4].isNull())
+			objParams.push_back(rawStored(row[4]));
+		else
+			objParams.push_back(Sqf::Parameters());
+
+		objParams.push_back(rawStored(row[5],precision().hitpoints));
+		objParams.push_back(Sqf::RoundDecimals(row[6].getDouble(),precision().fuel));
+		objParams.push_back(Sqf::RoundDecimals(row[7].getDouble(),precision().damage));
+	}
+	catch (const bad_lexical_cast&)
+	{
+		_logger.error("Skipping ObjectID " + lexical_cast<string>(objectId) + " load because of invalid data in db");
+		return false;
 	}
+
+	Sqf::AppendValue(objParams,out);
+	return true;
 }
 
-bool SqlObjDataSource::updateObjectInventory( int serverId, Int64 objectIdent, bool byUID, const Sqf::Value& inventory )
+bool SqlObjDataSource::updateObjectInventory( int serverId, Int64 objectIdent, bool byUID, const string& inventory )
 {
+	if (_writeFilter)
+	{
+		//hashes are kept by ObjectID, the one an object had by UID can't be told apart from the others
+		bool skip = !byUID && _writeFilter->isUnchanged(objectIdent,SqlObjWriteCache::COL_INVENTORY,inventory);
+		_writeFilter->countUpdate(skip);
+		if (skip)
+			return true;
+
+		if (byUID)
+			_writeFilter->forgetColumn(SqlObjWriteCache::COL_INVENTORY);
+		else
+			_writeFilter->written(objectIdent,SqlObjWriteCache::COL_INVENTORY,inventory);
+	}
+
+	if (_writeCache)
+	{
+		_writeCache->set(serverId,objectIdent,byUID,SqlObjWriteCache::COL_INVENTORY,storedLiteral(inventory));
+		return true;
+	}
+
 	unique_ptr<SqlStatement> stmt;
 	if (byUID)
 		stmt = getDB()->makeStatement(_stmtUpdateObjectbyUID, "UPDATE `"+_objTableName+"` SET `Inventory` = ? WHERE `ObjectUID` = ? AND `Instance` = ?");
 	else
 		stmt = getDB()->makeStatement(_stmtUpdateObjectByID, "UPDATE `"+_objTableName+"` SET `Inventory` = ? WHERE `ObjectID` = ? AND `Instance` = ?");
 
-	stmt->addString(lexical_cast<string>(inventory));
+	bindStored(*stmt,inventory);
 	stmt->addInt64(objectIdent);
 	stmt->addInt32(serverId);
 
@@ -186,6 +576,16 @@ bool SqlObjDataSource::updateObjectInventory( int serverId, Int64 objectIdent, b
 
 bool SqlObjDataSource::deleteObject( int serverId, Int64 objectIdent, bool byUID )
 {
+	if (_writeCache)
+	{
+		_writeCache->discard(serverId,objectIdent,byUID);
+		//the object might also have changes held back by its UID, which a new object could get next
+		if (!byUID)
+			_writeCache->flushByUID(serverId);
+	}
+	if (_writeFilter && !byUID)
+		_writeFilter->forget(objectIdent);
+
 	unique_ptr<SqlStatement> stmt;
 	if (byUID)
 		stmt = getDB()->makeStatement(_stmtDeleteObjectByUID, "DELETE FROM `"+_objTableName+"` WHERE `ObjectUID` = ? AND `Instance` = ?");
@@ -201,11 +601,41 @@ bool SqlObjDataSource::deleteObject( int serverId, Int64 objectIdent, bool byUID
 	return exRes;
 }
 
-bool SqlObjDataSource::updateVehicleMovement( int serverId, Int64 objectIdent, const Sqf::Value& worldspace, double fuel )
+bool SqlObjDataSource::updateVehicleMovement( int serverId, Int64 objectIdent, const string& worldspace, double fuel )
 {
+	string roundedWs = Sqf::RoundNumbers(worldspace,precision().worldspace);
+	double roundedFuel = Sqf::RoundDecimals(fuel,precision().fuel);
+	string fuelText = lexical_cast<string>(roundedFuel);
+
+	if (_writeFilter)
+	{
+		//small moves only count if something else changed as well
+		double x, y, z;
+		bool hasPos = (_moveDeadband > 0) && ReadWorldspacePosition(roundedWs,x,y,z);
+		bool sameWs = hasPos ? _writeFilter->isNearby(objectIdent,x,y,z,_moveDeadband) : 
+			_writeFilter->isUnchanged(objectIdent,SqlObjWriteCache::COL_WORLDSPACE,roundedWs);
+
+		bool skip = sameWs && _writeFilter->isUnchanged(objectIdent,SqlObjWriteCache::COL_FUEL,fuelText);
+		_writeFilter->countUpdate(skip);
+		if (skip)
+			return true;
+
+		_writeFilter->written(objectIdent,SqlObjWriteCache::COL_WORLDSPACE,roundedWs);
+		_writeFilter->written(objectIdent,SqlObjWriteCache::COL_FUEL,fuelText);
+		if (hasPos)
+			_writeFilter->writtenPosition(objectIdent,x,y,z);
+	}
+
+	if (_writeCache)
+	{
+		_writeCache->set(serverId,objectIdent,false,SqlObjWriteCache::COL_WORLDSPACE,storedLiteral(roundedWs));
+		_writeCache->set(serverId,objectIdent,false,SqlObjWriteCache::COL_FUEL,fuelText);
+		return true;
+	}
+
 	auto stmt = getDB()->makeStatement(_stmtUpdateVehicleMovement, "UPDATE `"+_objTableName+"` SET `Worldspace` = ? , `Fuel` = ? WHERE `ObjectID` = ?  AND `Instance` = ?");
-	stmt->addString(lexical_cast<string>(worldspace));
-	stmt->addDouble(fuel);
+	bindStored(*stmt,roundedWs);
+	stmt->addDouble(roundedFuel);
 	stmt->addInt64(objectIdent);
 	stmt->addInt32(serverId);
 	bool exRes = stmt->execute();
@@ -214,11 +644,34 @@ bool SqlObjDataSource::updateVehicleMovement( int serverId, Int64 objectIdent, c
 	return exRes;
 }
 
-bool SqlObjDataSource::updateVehicleStatus( int serverId, Int64 objectIdent, const Sqf::Value& hitPoints, double damage )
+bool SqlObjDataSource::updateVehicleStatus( int serverId, Int64 objectIdent, const string& hitPoints, double damage )
 {
+	string roundedHits = Sqf::RoundNumbers(hitPoints,precision().hitpoints);
+	double roundedDamage = Sqf::RoundDecimals(damage,precision().damage);
+	string damageText = lexical_cast<string>(roundedDamage);
+
+	if (_writeFilter)
+	{
+		bool skip = _writeFilter->isUnchanged(objectIdent,SqlObjWriteCache::COL_HITPOINTS,roundedHits) && 
+			_writeFilter->isUnchanged(objectIdent,SqlObjWriteCache::COL_DAMAGE,damageText);
+		_writeFilter->countUpdate(skip);
+		if (skip)
+			return true;
+
+		_writeFilter->written(objectIdent,SqlObjWriteCache::COL_HITPOINTS,roundedHits);
+		_writeFilter->written(objectIdent,SqlObjWriteCache::COL_DAMAGE,damageText);
+	}
+
+	if (_writeCache)
+	{
+		_writeCache->set(serverId,objectIdent,false,SqlObjWriteCache::COL_HITPOINTS,storedLiteral(roundedHits));
+		_writeCache->set(serverId,objectIdent,false,SqlObjWriteCache::COL_DAMAGE,damageText);
+		return true;
+	}
+
 	auto stmt = getDB()->makeStatement(_stmtUpdateVehicleStatus, "UPDATE `"+_objTableName+"` SET `Hitpoints` = ? , `Damage` = ? WHERE `ObjectID` = ? AND `Instance` = ?");
-	stmt->addString(lexical_cast<string>(hitPoints));
-	stmt->addDouble(damage);
+	bindStored(*stmt,roundedHits);
+	stmt->addDouble(roundedDamage);
 	stmt->addInt64(objectIdent);
 	stmt->addInt32(serverId);
 	bool exRes = stmt->execute();
@@ -228,24 +681,147 @@ bool SqlObjDataSource::updateVehicleStatus( int serverId, Int64 objectIdent, con
 }
 
 bool SqlObjDataSource::createObject( int serverId, const string& className, double damage, int characterId, 
-	const Sqf::Value& worldSpace, const Sqf::Value& inventory, const Sqf::Value& hitPoints, double fuel, Int64 uniqueId )
+	const string& worldSpace, const string& inventory, const string& hitPoints, double fuel, Int64 uniqueId, Int64& objectId )
 {
-	auto stmt = getDB()->makeStatement(_stmtCreateObject, 
-		"INSERT INTO `"+_objTableName+"` (`ObjectUID`, `Instance`, `Classname`, `Damage`, `CharacterID`, `Worldspace`, `Inventory`, `Hitpoints`, `Fuel`, `Datestamp`) "
-		"VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, CURRENT_TIMESTAMP)");
+	objectId = (_idBlockSize > 0) ? allocateObjectId() : 0;
+	//held back changes to an earlier object with the same UID go in before this one exists
+	if (_writeCache)
+		_writeCache->flush(serverId,uniqueId,true);
+
+	unique_ptr<SqlStatement> stmt;
+	if (objectId > 0)
+	{
+		stmt = getDB()->makeStatement(_stmtCreateObjectWithID, 
+			"INSERT INTO `"+_objTableName+"` (`ObjectID`, `ObjectUID`, `Instance`, `Classname`, `Damage`, `CharacterID`, `Worldspace`, `Inventory`, `Hitpoints`, `Fuel`, `Datestamp`) "
+			"VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, CURRENT_TIMESTAMP)");
+		stmt->addInt64(objectId);
+	}
+	else
+	{
+		stmt = getDB()->makeStatement(_stmtCreateObject, 
+			"INSERT INTO `"+_objTableName+"` (`ObjectUID`, `Instance`, `Classname`, `Damage`, `CharacterID`, `Worldspace`, `Inventory`, `Hitpoints`, `Fuel`, `Datestamp`) "
+			"VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, CURRENT_TIMESTAMP)");
+	}
 
 	stmt->addInt64(uniqueId);
 	stmt->addInt32(serverId);
 	stmt->addString(className);
-	stmt->addDouble(damage);
+	stmt->addDouble(Sqf::RoundDecimals(damage,precision().damage));
 	stmt->addInt32(characterId);
-	stmt->addString(lexical_cast<string>(worldSpace));
-	stmt->addString(lexical_cast<string>(inventory));
-	stmt->addString(lexical_cast<string>(hitPoints));
-	stmt->addDouble(fuel);
+	bindStored(*stmt,Sqf::RoundNumbers(worldSpace,precision().worldspace));
+	bindStored(*stmt,inventory);
+	bindStored(*stmt,Sqf::RoundNumbers(hitPoints,precision().hitpoints));
+	stmt->addDouble(Sqf::RoundDecimals(fuel,precision().fuel));
 	bool exRes = stmt->execute();
 	poco_assert(exRes == true);
 
 	return exRes;
 }
 
+void SqlObjDataSource::flushWrites()
+{
+	if (_writeCache)
+		_writeCache->flush();
+}
+
+bool SqlObjDataSource::fetchObjectChanges( UInt32& cursor, vector<string>& rows, vector<Int64>& uniqueIds, vector<int>& deletedIds )
+{
+	if (!_changeFeed)
+		return false;
+
+	vector<int> objectIds;
+	_changeFeed->changesSince(cursor,rows,objectIds,uniqueIds,deletedIds);
+
+	//what was last written isn't what's in the database anymore, so writing it again mustn't be skipped
+	if (_writeFilter)
+	{
+		for (auto it=objectIds.begin(); it!=objectIds.end(); ++it)
+			_writeFilter->forget(*it);
+		for (auto it=deletedIds.begin(); it!=deletedIds.end(); ++it)
+			_writeFilter->forget(*it);
+	}
+	return true;
+}
+
+#include <Poco/HexBinaryEncoder.h>
+#include <Poco/RandomStream.h>
+#include <sstream>
+
+namespace
+{
+	//one row per object table, NextID is where the next block starts and Owner is whoever reserved the last one
+	const char ID_SEQUENCE_TABLE[] = "Object_ID_SEQUENCE";
+	const int MAX_RESERVE_ATTEMPTS = 5;
+
+	string MakeReserveToken()
+	{
+		char randBytes[8];
+		Poco::RandomInputStream().read(randBytes,sizeof(randBytes));
+
+		std::ostringstream tokenStrm;
+		Poco::HexBinaryEncoder(tokenStrm).write(randBytes,sizeof(randBytes));
+		return tokenStrm.str();
+	}
+};
+
+Int64 SqlObjDataSource::allocateObjectId()
+{
+	Poco::FastMutex::ScopedLock lock(_idMutex);
+	if (_nextObjectId >= _objectIdBlockEnd && !reserveObjectIds())
+		return 0;
+
+	return _nextObjectId++;
+}
+
+bool SqlObjDataSource::reserveObjectIds()
+{
+	const string tableName = "'" + _objTableName + "'";
+	getDB()->directExecuteParams("INSERT IGNORE INTO `%s` (`TableName`, `NextID`) VALUES (%s, 1)", ID_SEQUENCE_TABLE, tableName.c_str());
+
+	//the block only counts as reserved if NextID was still what it was read as when it got moved past the block
+	//another server reserving right after that makes this one give up on the block, which only wastes it
+	for (int attempt=0; attempt<MAX_RESERVE_ATTEMPTS; attempt++)
+	{
+		auto seqRes = getDB()->queryParams("SELECT `NextID` FROM `%s` WHERE `TableName` = %s", ID_SEQUENCE_TABLE, tableName.c_str());
+		if (!seqRes || !seqRes->fetchRow())
+			break;
+
+		const Int64 seqNext = seqRes->at(0).getUInt64();
+		Int64 blockStart = seqNext;
+		//objects that were inserted without going through the sequence are skipped over
+		{
+			auto maxRes = getDB()->queryParams("SELECT COALESCE(MAX(`ObjectID`),0)+1 FROM `%s`", _objTableName.c_str());
+			if (maxRes && maxRes->fetchRow())
+				blockStart = std::max(blockStart,static_cast<Int64>(maxRes->at(0).getUInt64()));
+		}
+		//the last id of the block isn't handed out, it marks the end of the block in the object table
+		const Int64 blockEnd = blockStart + _idBlockSize + 1;
+		const Int64 markerId = blockEnd - 1;
+
+		const string token = MakeReserveToken();
+		if (!getDB()->directExecuteParams("UPDATE `%s` SET `NextID` = %s, `Owner` = '%s' WHERE `TableName` = %s AND `NextID` = %s", ID_SEQUENCE_TABLE, 
+			lexical_cast<string>(blockEnd).c_str(), token.c_str(), tableName.c_str(), lexical_cast<string>(seqNext).c_str()))
+			break;
+
+		auto checkRes = getDB()->queryParams("SELECT `NextID`, `Owner` FROM `%s` WHERE `TableName` = %s", ID_SEQUENCE_TABLE, tableName.c_str());
+		if (checkRes && checkRes->fetchRow() && 
+			static_cast<Int64>(checkRes->at(0).getUInt64()) == blockEnd && checkRes->at(1).getString() == token)
+		{
+			//inserts that don't use a block (other servers without one, tools) would otherwise get ids from inside it
+			//inserting the marker moves the table's own counter past the block (it's never moved down), the row itself isn't needed after that
+			//if something already took the marker id, the block is given up on
+			if (!getDB()->directExecuteParams("INSERT INTO `%s` (`ObjectID`, `Instance`, `Datestamp`) VALUES (%s, 0, CURRENT_TIMESTAMP)", 
+				_objTableName.c_str(), lexical_cast<string>(markerId).c_str()))
+				continue;
+			getDB()->directExecuteParams("DELETE FROM `%s` WHERE `ObjectID` = %s AND `Classname` IS NULL", _objTableName.c_str(), lexical_cast<string>(markerId).c_str());
+
+			_nextObjectId = blockStart;
+			_objectIdBlockEnd = markerId;
+			_logger.debug("Reserved ObjectIDs " + lexical_cast<string>(blockStart) + " to " + lexical_cast<string>(markerId-1));
+			return true;
+		}
+	}
+
+	_logger.error("Failed to reserve ObjectIDs from " + string(ID_SEQUENCE_TABLE) + ", new objects get theirs when they are inserted");
+	return false;
+}
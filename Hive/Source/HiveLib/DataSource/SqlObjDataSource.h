@@ -22,27 +22,94 @@
 #include "ObjDataSource.h"
 #include "Database/SqlStatement.h"
 
+#include <boost/unordered_set.hpp>
+#include <Poco/Mutex.h>
+
+class ObjectSnapshot;
+class SqlObjCleaner;
+class SqlObjWriteCache;
+class SqlObjChangeFeed;
+class WriteFilter;
+class QueryResult;
+
 namespace Poco { namespace Util { class AbstractConfiguration; }; };
 class SqlObjDataSource : public SqlDataSource, public ObjDataSource
 {
 public:
 	SqlObjDataSource(Poco::Logger& logger, shared_ptr<Database> db, const Poco::Util::AbstractConfiguration* conf);
-	~SqlObjDataSource() {}
+	~SqlObjDataSource();
 
-	void populateObjects( int serverId, ServerObjectsQueue& queue ) override;
-	bool updateObjectInventory( int serverId, Int64 objectIdent, bool byUID, const Sqf::Value& inventory ) override;
+	bool populateObjects( int serverId, ServerObjectsQueue& queue ) override;
+	void useLoadedObjects( int serverId ) override;
+	bool updateObjectInventory( int serverId, Int64 objectIdent, bool byUID, const string& inventory ) override;
 	bool deleteObject( int serverId, Int64 objectIdent, bool byUID ) override;
-	bool updateVehicleMovement( int serverId, Int64 objectIdent, const Sqf::Value& worldspace, double fuel ) override;
-	bool updateVehicleStatus( int serverId, Int64 objectIdent, const Sqf::Value& hitPoints, double damage ) override;
+	bool updateVehicleMovement( int serverId, Int64 objectIdent, const string& worldspace, double fuel ) override;
+	bool updateVehicleStatus( int serverId, Int64 objectIdent, const string& hitPoints, double damage ) override;
 	bool createObject( int serverId, const string& className, double damage, int characterId, 
-		const Sqf::Value& worldSpace, const Sqf::Value& inventory, const Sqf::Value& hitPoints, double fuel, Int64 uniqueId ) override;
+		const string& worldSpace, const string& inventory, const string& hitPoints, double fuel, Int64 uniqueId, Int64& objectId ) override;
+	void flushWrites() override;
+	bool fetchObjectChanges( UInt32& cursor, vector<string>& rows, vector<Int64>& uniqueIds, vector<int>& deletedIds ) override;
 private:
+	//rows are serialized on worker threads, a batch at a time
+	class ObjectBatch;
+	class LoadWorker;
+	//appends the ["OBJ",...] row made from the fields of an Object_DATA row, false if the row has invalid data
+	bool serializeObject(const Field* row, string& out) const;
+
+	//serialized rows with their ObjectIDs, in the order they were loaded
+	struct LoadedObjects
+	{
+		string text;
+		vector<size_t> ends;
+		vector<int> ids;
+
+		void swap(LoadedObjects& other)
+		{
+			text.swap(other.text);
+			ends.swap(other.ends);
+			ids.swap(other.ids);
+		}
+	};
+	//serializes the rows of an object query on the load threads
+	//fetchedIds (if given) gets the ObjectID of every fetched row, including ones that were skipped
+	//false if rows got lost for something other than invalid data
+	bool loadObjects(QueryResult& res, LoadedObjects& out, boost::unordered_set<int>* fetchedIds);
+	//puts the snapshot rows that are still in the database together with the rows that changed since it was written
+	bool mergeSnapshot(int serverId, const ObjectSnapshot& snapshot, const boost::unordered_set<int>& fetchedIds, LoadedObjects& changed);
+	//everything that affects how rows are serialized, a snapshot made with different settings can't be used
+	string snapshotSettings() const;
+	//extra WHERE conditions of the queries that load objects, so the ones about to be cleaned up aren't loaded
+	string loadFilterSql() const;
+
+	//ObjectIDs for new objects are handed out from blocks reserved in the sequence table, 0 if no block could be reserved
+	Int64 allocateObjectId();
+	bool reserveObjectIds();
+
 	string _objTableName;
 	int _cleanupPlacedDays;
+	unique_ptr<SqlObjCleaner> _cleaner;
+	//only there if updates are held back
+	unique_ptr<SqlObjWriteCache> _writeCache;
+	//only there if changes are followed
+	unique_ptr<SqlObjChangeFeed> _changeFeed;
+	//only there if unchanged updates are skipped, objects are known by ObjectID
+	unique_ptr<WriteFilter> _writeFilter;
+	//meters a vehicle has to move for its position to be written again, 0 writes every change
+	double _moveDeadband;
 	bool _vehicleOOBReset;
+	int _loadThreads;
+	string _snapshotFile;
+	//what the last populateObjects loaded, only kept when the snapshot or the change feed need it once the objects are used
+	int _loadedServerId;
+	string _loadedWatermark;
+	LoadedObjects _loadedObjects;
+
+	int _idBlockSize;
+	Int64 _nextObjectId;
+	Int64 _objectIdBlockEnd;
+	Poco::FastMutex _idMutex;
 
 	//statement ids
-	SqlStatementID _stmtDeleteOldObject;
 	SqlStatementID _stmtUpdateObjectbyUID;
 	SqlStatementID _stmtUpdateObjectByID;
 	SqlStatementID _stmtDeleteObjectByUID;
@@ -50,4 +117,5 @@ private:
 	SqlStatementID _stmtUpdateVehicleMovement;
 	SqlStatementID _stmtUpdateVehicleStatus;
 	SqlStatementID _stmtCreateObject;
+	SqlStatementID _stmtCreateObjectWithID;
 };
\ No newline at end of file
@@ -0,0 +1,259 @@
+/*
+* Copyright (C) 2009-2013 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "SqlObjWriteCache.h"
+#include "Database/Database.h"
+
+#include <Poco/Logger.h>
+
+#include <boost/lexical_cast.hpp>
+#include <algorithm>
+#include <limits>
+using boost::lexical_cast;
+
+namespace
+{
+	const char* COLUMN_NAMES[SqlObjWriteCache::NUM_COLUMNS] = { "Worldspace", "Fuel", "Hitpoints", "Damage", "Inventory" };
+
+	//a statement is cut off at whichever of these comes first
+	const size_t MAX_BATCH_ROWS = 100;
+	const size_t MAX_BATCH_SQL = 512*1024;
+};
+
+SqlObjWriteCache::SqlObjWriteCache( Poco::Logger& logger, shared_ptr<Database> db, const string& tableName, long flushIntervalMS )
+	: _logger(logger), _db(db), _tableName(tableName), _flushIntervalMS(flushIntervalMS), 
+	_thread("Object Write Cache"), _isRunning(false), _lastSeq(0), _numSet(0), _numWritten(0)
+{
+}
+
+SqlObjWriteCache::~SqlObjWriteCache()
+{
+	stop();
+}
+
+void SqlObjWriteCache::start()
+{
+	if (_isRunning)
+		return;
+
+	_isRunning = true;
+	_thread.start(*this);
+}
+
+void SqlObjWriteCache::stop()
+{
+	if (_isRunning)
+	{
+		_isRunning = false;	//send stop signal
+		_wakeUp.set();
+		_thread.join();
+	}
+	flush();
+}
+
+void SqlObjWriteCache::run()
+{
+	_db->threadEnter();
+
+	while (_isRunning)
+	{
+		_wakeUp.tryWait(_flushIntervalMS);
+		if (!_isRunning)
+			break;
+
+		flush();
+	}
+
+	_db->threadExit();
+}
+
+void SqlObjWriteCache::set( int serverId, Int64 objectIdent, bool byUID, Column col, string literal )
+{
+	Poco::FastMutex::ScopedLock lock(_pendingMutex);
+	PendingObject& pending = _pending[ObjectKey(serverId,byUID,objectIdent)];
+	pending.values[col] = std::move(literal);
+	pending.seqs[col] = ++_lastSeq;
+	_numSet++;
+}
+
+void SqlObjWriteCache::discard( int serverId, Int64 objectIdent, bool byUID )
+{
+	Poco::FastMutex::ScopedLock lock(_pendingMutex);
+	_pending.erase(ObjectKey(serverId,byUID,objectIdent));
+}
+
+void SqlObjWriteCache::flush()
+{
+	Poco::FastMutex::ScopedLock flushLock(_flushMutex);
+
+	PendingMap toWrite;
+	size_t numSet = 0;
+	{
+		Poco::FastMutex::ScopedLock lock(_pendingMutex);
+		toWrite.swap(_pending);
+		std::swap(numSet,_numSet);
+	}
+	write(toWrite,numSet);
+}
+
+void SqlObjWriteCache::flush( int serverId, Int64 objectIdent, bool byUID )
+{
+	Poco::FastMutex::ScopedLock flushLock(_flushMutex);
+
+	PendingMap toWrite;
+	{
+		Poco::FastMutex::ScopedLock lock(_pendingMutex);
+		auto it = _pending.find(ObjectKey(serverId,byUID,objectIdent));
+		if (it == _pending.end())
+			return;
+
+		toWrite.insert(*it);
+		_pending.erase(it);
+	}
+	write(toWrite,0);
+}
+
+void SqlObjWriteCache::flushByUID( int serverId )
+{
+	Poco::FastMutex::ScopedLock flushLock(_flushMutex);
+
+	PendingMap toWrite;
+	{
+		Poco::FastMutex::ScopedLock lock(_pendingMutex);
+		//keys of an instance and key type are next to each other
+		auto first = _pending.lower_bound(ObjectKey(serverId,true,std::numeric_limits<Int64>::min()));
+		auto last = _pending.lower_bound(ObjectKey(serverId+1,false,std::numeric_limits<Int64>::min()));
+		toWrite.insert(first,last);
+		_pending.erase(first,last);
+	}
+	write(toWrite,0);
+}
+
+void SqlObjWriteCache::write( PendingMap& toWrite, size_t numSet )
+{
+	if (toWrite.empty())
+		return;
+
+	//an object can have pending changes under both its ObjectID and its ObjectUID, so a column that
+	//was set through both has to be written in the order it was set, the changes are replayed in that order
+	vector<PendingCell> cells;
+	for (auto it=toWrite.begin(); it!=toWrite.end(); ++it)
+	{
+		for (int col=0; col<NUM_COLUMNS; col++)
+		{
+			if (!it->second.values[col].empty())
+				cells.push_back(PendingCell(it,col));
+		}
+	}
+	std::sort(cells.begin(),cells.end());
+
+	//one open batch per key type, a column is only ever in one of them
+	PendingMap batches[2];
+	size_t sqlSizes[2] = { 0, 0 };
+	bool hasColumn[2][NUM_COLUMNS] = {};
+	for (size_t i=0; i<cells.size(); i++)
+	{
+		const ObjectKey& key = cells[i].it->first;
+		const int col = cells[i].col;
+		if (i > 0 && key.serverId != cells[i-1].it->first.serverId)
+		{
+			for (int type=0; type<2; type++)
+			{
+				writeBatch(batches[type]);
+				sqlSizes[type] = 0;
+				std::fill(hasColumn[type],hasColumn[type]+NUM_COLUMNS,false);
+			}
+		}
+
+		//the other key type's change to this column came first
+		const int type = key.byUID ? 1 : 0;
+		if (hasColumn[1-type][col])
+		{
+			writeBatch(batches[1-type]);
+			sqlSizes[1-type] = 0;
+			std::fill(hasColumn[1-type],hasColumn[1-type]+NUM_COLUMNS,false);
+		}
+
+		string& value = batches[type][key].values[col];
+		value.swap(cells[i].it->second.values[col]);
+		sqlSizes[type] += value.length();
+		hasColumn[type][col] = true;
+
+		if (batches[type].size() >= MAX_BATCH_ROWS || sqlSizes[type] >= MAX_BATCH_SQL)
+		{
+			writeBatch(batches[type]);
+			sqlSizes[type] = 0;
+			std::fill(hasColumn[type],hasColumn[type]+NUM_COLUMNS,false);
+		}
+	}
+	writeBatch(batches[0]);
+	writeBatch(batches[1]);
+
+	_numWritten += toWrite.size();
+	if (numSet > 0)
+	{
+		_logger.debug("Wrote " + lexical_cast<string>(toWrite.size()) + " objects with " + lexical_cast<string>(numSet) + " changes, " + 
+			lexical_cast<string>(_numWritten) + " total");
+	}
+}
+
+void SqlObjWriteCache::writeBatch( PendingMap& rows )
+{
+	if (rows.empty())
+		return;
+
+	const ObjectKey& firstKey = rows.begin()->first;
+	const string keyField = firstKey.byUID ? "`ObjectUID`" : "`ObjectID`";
+
+	//every column that changed for any of the rows, the rest keep what they had
+	string sql = "UPDATE `" + _tableName + "` SET ";
+	bool firstCol = true;
+	for (size_t col=0; col<NUM_COLUMNS; col++)
+	{
+		const string colName = string("`") + COLUMN_NAMES[col] + "`";
+		string caseSql;
+		for (auto it=rows.begin(); it!=rows.end(); ++it)
+		{
+			if (it->second.values[col].empty())
+				continue;
+
+			caseSql += " WHEN " + lexical_cast<string>(it->first.ident) + " THEN " + it->second.values[col];
+		}
+		if (caseSql.empty())
+			continue;
+
+		if (!firstCol)
+			sql += ", ";
+		sql += colName + " = CASE " + keyField + caseSql + " ELSE " + colName + " END";
+		firstCol = false;
+	}
+
+	sql += " WHERE `Instance` = " + lexical_cast<string>(firstKey.serverId) + " AND " + keyField + " IN (";
+	for (auto it=rows.begin(); it!=rows.end(); ++it)
+	{
+		if (it != rows.begin())
+			sql += ",";
+		sql += lexical_cast<string>(it->first.ident);
+	}
+	sql += ")";
+
+	if (!_db->execute(sql.c_str()))
+		_logger.error("Error queueing update of " + lexical_cast<string>(rows.size()) + " objects");
+
+	rows.clear();
+}
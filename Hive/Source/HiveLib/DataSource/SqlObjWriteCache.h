@@ -0,0 +1,133 @@
+/*
+* Copyright (C) 2009-2013 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "Shared/Common/Types.h"
+
+#include <Poco/Event.h>
+#include <Poco/Mutex.h>
+#include <Poco/Runnable.h>
+#include <Poco/Thread.h>
+
+namespace Poco { class Logger; };
+class Database;
+
+//holds back object updates and writes them out every so often, only the latest value of each column is kept
+//everything pending is written with a few multi-row UPDATEs, through the same queue the other object writes go through
+class SqlObjWriteCache : public Poco::Runnable
+{
+public:
+	enum Column
+	{
+		COL_WORLDSPACE,
+		COL_FUEL,
+		COL_HITPOINTS,
+		COL_DAMAGE,
+		COL_INVENTORY,
+		NUM_COLUMNS
+	};
+
+	SqlObjWriteCache(Poco::Logger& logger, shared_ptr<Database> db, const string& tableName, long flushIntervalMS);
+	~SqlObjWriteCache();
+
+	void start();
+	//writes out what's left
+	void stop();
+	void run() override;
+
+	//literal is the value as it goes into SQL, already quoted or encoded
+	void set(int serverId, Int64 objectIdent, bool byUID, Column col, string literal);
+	//an object that's deleted doesn't need its pending changes anymore
+	void discard(int serverId, Int64 objectIdent, bool byUID);
+	//queues all pending changes
+	void flush();
+	//queues the pending changes of one object
+	void flush(int serverId, Int64 objectIdent, bool byUID);
+	//queues the pending changes made by ObjectUID, before something could make a UID mean another object
+	void flushByUID(int serverId);
+private:
+	struct ObjectKey
+	{
+		ObjectKey(int serverId, bool byUID, Int64 ident) : serverId(serverId), byUID(byUID), ident(ident) {}
+
+		bool operator<(const ObjectKey& other) const
+		{
+			if (serverId != other.serverId)
+				return serverId < other.serverId;
+			if (byUID != other.byUID)
+				return byUID < other.byUID;
+			return ident < other.ident;
+		}
+
+		int serverId;
+		bool byUID;
+		Int64 ident;
+	};
+	//empty strings are columns that didn't change, seqs say when each one was last set
+	struct PendingObject
+	{
+		PendingObject()
+		{
+			for (int i=0; i<NUM_COLUMNS; i++)
+				seqs[i] = 0;
+		}
+
+		string values[NUM_COLUMNS];
+		UInt64 seqs[NUM_COLUMNS];
+	};
+	//ordered, so rows of the same instance and key type are next to each other, in key order
+	typedef map<ObjectKey,PendingObject> PendingMap;
+	//one changed column of a pending object
+	struct PendingCell
+	{
+		PendingCell(PendingMap::iterator it, int col) : it(it), col(col) {}
+
+		bool operator<(const PendingCell& other) const
+		{
+			if (it->first.serverId != other.it->first.serverId)
+				return it->first.serverId < other.it->first.serverId;
+			return it->second.seqs[col] < other.it->second.seqs[other.col];
+		}
+
+		PendingMap::iterator it;
+		int col;
+	};
+
+	//queues the pending map in batches, the values are moved out of it
+	void write(PendingMap& toWrite, size_t numSet);
+	//writes the rows, which share an instance and key type, and empties them
+	void writeBatch(PendingMap& rows);
+
+	Poco::Logger& _logger;
+	shared_ptr<Database> _db;
+	string _tableName;
+	long _flushIntervalMS;
+
+	Poco::Thread _thread;
+	Poco::Event _wakeUp;
+	volatile bool _isRunning;
+
+	Poco::FastMutex _pendingMutex;
+	PendingMap _pending;
+	UInt64 _lastSeq;
+	//only one flush at a time, so updates are queued in the order they were made
+	Poco::FastMutex _flushMutex;
+	size_t _numSet;
+	size_t _numWritten;
+};
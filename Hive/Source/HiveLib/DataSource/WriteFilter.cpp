@@ -0,0 +1,133 @@
+/*
+* Copyright (C) 2009-2013 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "WriteFilter.h"
+
+#include <Poco/Logger.h>
+
+#include <boost/functional/hash.hpp>
+#include <boost/lexical_cast.hpp>
+using boost::lexical_cast;
+
+namespace
+{
+	const UInt64 SUMMARY_EVERY = 10000;
+
+	size_t HashValue(const string& value) { return boost::hash_range(value.begin(),value.end()); }
+};
+
+WriteFilter::WriteFilter( Poco::Logger& logger, const string& what, int numColumns )
+	: _logger(logger), _what(what), _numColumns(numColumns), _generations(numColumns,0), _numWritten(0), _numSkipped(0)
+{
+}
+
+WriteFilter::~WriteFilter()
+{
+	if (_numWritten + _numSkipped > 0)
+		logSummary();
+}
+
+bool WriteFilter::isUnchanged( Int64 entity, int column, const string& value ) const
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	auto it = _hashes.find(ColumnKey(entity,column));
+	if (it == _hashes.end())
+		return false;
+
+	const ColumnHash& known = it->second;
+	return known.generation == _generations[column] && known.length == value.length() && known.hash == HashValue(value);
+}
+
+bool WriteFilter::isNearby( Int64 entity, double x, double y, double z, double deadband ) const
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	auto it = _positions.find(entity);
+	if (it == _positions.end())
+		return false;
+
+	const Position& known = it->second;
+	double dx = x - known.x;
+	double dy = y - known.y;
+	double dz = z - known.z;
+	return (dx*dx + dy*dy + dz*dz) < deadband*deadband;
+}
+
+void WriteFilter::written( Int64 entity, int column, const string& value )
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	ColumnHash& known = _hashes[ColumnKey(entity,column)];
+	known.hash = HashValue(value);
+	known.length = value.length();
+	known.generation = _generations[column];
+}
+
+void WriteFilter::writtenPosition( Int64 entity, double x, double y, double z )
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	Position& known = _positions[entity];
+	known.x = x;
+	known.y = y;
+	known.z = z;
+}
+
+void WriteFilter::forget( Int64 entity )
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	for (int i=0; i<_numColumns; i++)
+		_hashes.erase(ColumnKey(entity,i));
+
+	_positions.erase(entity);
+}
+
+void WriteFilter::forgetColumn( int column )
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+	_generations[column]++;
+}
+
+void WriteFilter::clear()
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	_hashes.clear();
+	_positions.clear();
+}
+
+void WriteFilter::countUpdate( bool skipped )
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	if (skipped)
+		_numSkipped++;
+	else
+		_numWritten++;
+
+	if ((_numWritten + _numSkipped) % SUMMARY_EVERY == 0)
+		logSummary();
+}
+
+void WriteFilter::logSummary() const
+{
+	_logger.information("Skipped " + lexical_cast<string>(_numSkipped) + " of " + lexical_cast<string>(_numWritten + _numSkipped) + 
+		" " + _what + " updates that wouldn't have changed anything");
+}
@@ -0,0 +1,82 @@
+/*
+* Copyright (C) 2009-2013 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "Shared/Common/Types.h"
+
+#include <boost/unordered_map.hpp>
+#include <Poco/Mutex.h>
+
+namespace Poco { class Logger; };
+
+//remembers a hash of the last value written to each column of each entity (object, character),
+//so updates that would write the same thing again can be left out.
+//values changed in the database by anything else aren't seen, forget() an entity when it's read back
+class WriteFilter
+{
+public:
+	//what names the entities in the logged summary, columns are numbered from 0 to numColumns-1
+	WriteFilter(Poco::Logger& logger, const string& what, int numColumns);
+	~WriteFilter();
+
+	//true if that column was last written with this value
+	bool isUnchanged(Int64 entity, int column, const string& value) const;
+	//true if the last written position is closer than deadband meters
+	bool isNearby(Int64 entity, double x, double y, double z, double deadband) const;
+	//called after a write is queued
+	void written(Int64 entity, int column, const string& value);
+	void writtenPosition(Int64 entity, double x, double y, double z);
+
+	//nothing is known about the entity anymore
+	void forget(Int64 entity);
+	//nothing is known about the column of any entity, for writes that went through another kind of key
+	void forgetColumn(int column);
+	//nothing is known about anything
+	void clear();
+
+	//every update is counted as written or skipped, a summary is logged every so often
+	void countUpdate(bool skipped);
+private:
+	struct ColumnHash
+	{
+		size_t hash;
+		size_t length;
+		UInt32 generation;
+	};
+	typedef std::pair<Int64,int> ColumnKey;
+	struct Position
+	{
+		double x, y, z;
+	};
+
+	void logSummary() const;
+
+	Poco::Logger& _logger;
+	string _what;
+	int _numColumns;
+
+	mutable Poco::FastMutex _mutex;
+	boost::unordered_map<ColumnKey,ColumnHash> _hashes;
+	boost::unordered_map<Int64,Position> _positions;
+	//hashes remembered before their column was forgotten are stale
+	vector<UInt32> _generations;
+
+	UInt64 _numWritten;
+	UInt64 _numSkipped;
+};
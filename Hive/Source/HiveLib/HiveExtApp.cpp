@@ -98,12 +98,29 @@ void HiveExtApp::setupClock()
 	_timeOffset = now - utc;
 }
 
+void HiveExtApp::setupNumberFormat()
+{
+	Poco::AutoPtr<Poco::Util::AbstractConfiguration> numConf(config().createView("Numbers"));
+	string formatType = numConf->getString("Format","Compatible");
+
+	if (boost::iequals(formatType,"Shortest"))
+		Sqf::SetNumberFormat(Sqf::NUMBERS_SHORTEST);
+	else
+	{
+		if (!boost::iequals(formatType,"Compatible"))
+			logger().warning("Invalid value for Numbers.Format configuration variable (expected Compatible or Shortest, given: "+formatType+")");
+
+		Sqf::SetNumberFormat(Sqf::NUMBERS_COMPATIBLE);
+	}
+}
+
 #include "Version.h"
 
 int HiveExtApp::main( const std::vector<std::string>& args )
 {
 	logger().information("HiveExt " + GIT_VERSION.substr(0,12));
 	setupClock();
+	setupNumberFormat();
 
 	if (!this->initialiseService())
 	{
@@ -114,34 +131,64 @@ int HiveExtApp::main( const std::vector<std::string>& args )
 	return EXIT_OK;
 }
 
-HiveExtApp::HiveExtApp(string suffixDir) : AppServer("HiveExt",suffixDir), _serverId(-1)
+namespace
+{
+	template<typename Signature>
+	bool CallMethod(const boost::function<Sqf::Value (Signature&)>& func, const Sqf::Document& doc, const Sqf::DocArgs& args, Sqf::Value& result, string& error)
+	{
+		Signature decoded;
+		if (!Sqf::DecodeArgs(doc,args,decoded,error))
+			return false;
+
+		result = func(decoded);
+		return true;
+	}
+};
+
+template<typename Signature>
+void HiveExtApp::registerMethod( int methodId, boost::function<Sqf::Value (Signature&)> func )
+{
+	if (methods.size() <= static_cast<size_t>(methodId))
+		methods.resize(methodId+1);
+
+	methods[methodId] = boost::bind(&CallMethod<Signature>,func,_1,_2,_3,_4);
+}
+
+HiveExtApp::HiveExtApp(string suffixDir) : AppServer("HiveExt",suffixDir), _serverId(-1), _callOutputSize(0), 
+	_preloadServerId(-1), _preloadDb(nullptr), _preloadOk(false), _preloadThread("Object Preload"), _preloadRunner(*this,&HiveExtApp::preloadObjects), 
+	_lastContinuation(0)
 {
 	//custom data retrieval
-	handlers[500] = boost::bind(&HiveExtApp::changeTableAccess,this,_1);	//mechanism for setting up custom table permissions
-	handlers[501] = boost::bind(&HiveExtApp::dataRequest,this,_1,false);	//sync load init and wait
-	handlers[502] = boost::bind(&HiveExtApp::dataRequest,this,_1,true);		//async load init
-	handlers[503] = boost::bind(&HiveExtApp::dataStatus,this,_1);			//retrieve request status and info
-	handlers[504] = boost::bind(&HiveExtApp::dataFetchRow,this,_1);			//fetch row from completed query
-	handlers[505] = boost::bind(&HiveExtApp::dataClose,this,_1);			//destroy any trace of request
+	registerMethod<TableAccessArgs>(500,boost::bind(&HiveExtApp::changeTableAccess,this,_1));	//mechanism for setting up custom table permissions
+	registerMethod<DataRequestArgs>(501,boost::bind(&HiveExtApp::dataRequest,this,_1,false));	//sync load init and wait
+	registerMethod<DataRequestArgs>(502,boost::bind(&HiveExtApp::dataRequest,this,_1,true));	//async load init
+	registerMethod<TokenArgs>(503,boost::bind(&HiveExtApp::dataStatus,this,_1));				//retrieve request status and info
+	registerMethod<TokenArgs>(504,boost::bind(&HiveExtApp::dataFetchRow,this,_1));				//fetch row from completed query
+	registerMethod<TokenArgs>(505,boost::bind(&HiveExtApp::dataClose,this,_1));				//destroy any trace of request
 	//server and object stuff
-	handlers[302] = boost::bind(&HiveExtApp::streamObjects,this,_1);		//Returns object count, superKey first time, rows after that
-	handlers[303] = boost::bind(&HiveExtApp::objectInventory,this,_1,false);
-	handlers[304] = boost::bind(&HiveExtApp::objectDelete,this,_1,false);
-	handlers[305] = boost::bind(&HiveExtApp::vehicleMoved,this,_1);
-	handlers[306] = boost::bind(&HiveExtApp::vehicleDamaged,this,_1);
-	handlers[307] = boost::bind(&HiveExtApp::getDateTime,this,_1);
-	handlers[308] = boost::bind(&HiveExtApp::objectPublish,this,_1);
-	handlers[309] = boost::bind(&HiveExtApp::objectInventory,this,_1,true);
-	handlers[310] = boost::bind(&HiveExtApp::objectDelete,this,_1,true);
-	handlers[399] = boost::bind(&HiveExtApp::serverShutdown,this,_1);		//Shut down the hiveExt instance
+	registerMethod<StreamObjectsArgs>(302,boost::bind(&HiveExtApp::streamObjects,this,_1));	//Returns object count, superKey first time, rows after that
+	registerMethod<ObjectInventoryArgs>(303,boost::bind(&HiveExtApp::objectInventory,this,_1,false));
+	registerMethod<ObjectDeleteArgs>(304,boost::bind(&HiveExtApp::objectDelete,this,_1,false));
+	registerMethod<VehicleUpdateArgs>(305,boost::bind(&HiveExtApp::vehicleMoved,this,_1));
+	registerMethod<VehicleUpdateArgs>(306,boost::bind(&HiveExtApp::vehicleDamaged,this,_1));
+	registerMethod<NoArgs>(307,boost::bind(&HiveExtApp::getDateTime,this,_1));
+	registerMethod<ObjectPublishArgs>(308,boost::bind(&HiveExtApp::objectPublish,this,_1));
+	registerMethod<ObjectInventoryArgs>(309,boost::bind(&HiveExtApp::objectInventory,this,_1,true));
+	registerMethod<ObjectDeleteArgs>(310,boost::bind(&HiveExtApp::objectDelete,this,_1,true));
+	registerMethod<ObjectsNearArgs>(311,boost::bind(&HiveExtApp::objectsNear,this,_1));			//Objects within a radius of a position, from memory
+	registerMethod<ObjectsOwnedArgs>(312,boost::bind(&HiveExtApp::objectsOwned,this,_1));		//Objects of a character, from memory
+	registerMethod<ObjectChangesArgs>(313,boost::bind(&HiveExtApp::objectChanges,this,_1));		//Objects changed in the database by others
+	registerMethod<KeyArgs>(399,boost::bind(&HiveExtApp::serverShutdown,this,_1));				//Shut down the hiveExt instance
+	registerMethod<BatchArgs>(600,boost::bind(&HiveExtApp::batchCall,this,_1));					//Several method calls in one request
+	registerMethod<TokenArgs>(601,boost::bind(&HiveExtApp::continueResult,this,_1));			//Next piece of a result that was too big
 	//player/character loads
-	handlers[101] = boost::bind(&HiveExtApp::loadPlayer,this,_1);
-	handlers[102] = boost::bind(&HiveExtApp::loadCharacterDetails,this,_1);
-	handlers[103] = boost::bind(&HiveExtApp::recordCharacterLogin,this,_1);
+	registerMethod<LoadPlayerArgs>(101,boost::bind(&HiveExtApp::loadPlayer,this,_1));
+	registerMethod<CharacterArgs>(102,boost::bind(&HiveExtApp::loadCharacterDetails,this,_1));
+	registerMethod<CharacterLoginArgs>(103,boost::bind(&HiveExtApp::recordCharacterLogin,this,_1));
 	//character updates
-	handlers[201] = boost::bind(&HiveExtApp::playerUpdate,this,_1);
-	handlers[202] = boost::bind(&HiveExtApp::playerDeath,this,_1);
-	handlers[203] = boost::bind(&HiveExtApp::playerInit,this,_1);
+	registerMethod<PlayerUpdateArgs>(201,boost::bind(&HiveExtApp::playerUpdate,this,_1));
+	registerMethod<PlayerDeathArgs>(202,boost::bind(&HiveExtApp::playerDeath,this,_1));
+	registerMethod<PlayerInitArgs>(203,boost::bind(&HiveExtApp::playerInit,this,_1));
 }
 
 #include <boost/lexical_cast.hpp>
@@ -150,27 +197,25 @@ using boost::bad_lexical_cast;
 
 void HiveExtApp::callExtension( const char* function, char* output, size_t outputSize )
 {
-	Sqf::Parameters params;
-	try
-	{
-		params = lexical_cast<Sqf::Parameters>(function);	
-	}
-	catch(bad_lexical_cast)
-	{
-		logger().error("Cannot parse function: " + string(function));
-		return;
-	}
+	_callDoc.parseParameters(function,strlen(function));
+	_callArgs.clear();
+	_callOutputSize = outputSize;
 
 	int funcNum = -1;
 	try
 	{
-		string childIdent = boost::get<string>(params.at(0));
-		if (childIdent != "CHILD")
+		const size_t root = _callDoc.root();
+		size_t childIdent = _callDoc.child(root,0);
+		if (_callDoc.type(childIdent) != Sqf::Document::TYPE_STRING || _callDoc.getStringAny(childIdent) != "CHILD")
 			throw std::runtime_error("First element in parameters must be CHILD");
 
-		params.erase(params.begin());
-		funcNum = boost::get<int>(params.at(0));
-		params.erase(params.begin());
+		size_t funcIdent = _callDoc.child(root,1);
+		if (_callDoc.type(funcIdent) != Sqf::Document::TYPE_INT)
+			throw boost::bad_get();
+		funcNum = _callDoc.getIntAny(funcIdent);
+
+		for (size_t arg=_callDoc.next(funcIdent);arg!=_callDoc.next(root);arg=_callDoc.next(arg))
+			_callArgs.push_back(arg);
 	}
 	catch (...)
 	{
@@ -178,7 +223,7 @@ void HiveExtApp::callExtension( const char* function, char* output, size_t outpu
 		return;
 	}
 
-	if (handlers.count(funcNum) < 1)
+	if (funcNum < 0 || static_cast<size_t>(funcNum) >= methods.size() || methods[funcNum].empty())
 	{
 		logger().error("Invalid method id: " + lexical_cast<string>(funcNum));
 		return;
@@ -187,13 +232,27 @@ void HiveExtApp::callExtension( const char* function, char* output, size_t outpu
 	if (logger().debug())
 		logger().debug("Original params: |" + string(function) + "|");
 
-	logger().information("Method: " + lexical_cast<string>(funcNum) + " Params: " + lexical_cast<string>(params));
-	HandlerFunc handler = handlers[funcNum];
+	if (logger().information())
+	{
+		string paramsStr;
+		for (auto it=_callArgs.begin();it!=_callArgs.end();++it)
+		{
+			_callDoc.write(*it,paramsStr,false);
+			paramsStr += ':';
+		}
+		logger().information("Method: " + lexical_cast<string>(funcNum) + " Params: " + paramsStr);
+	}
+
 	Sqf::Value res;
 	boost::optional<ServerShutdownException> shutdownExc;
 	try
 	{
-		res = handler(params);
+		string argError;
+		if (!methods[funcNum](_callDoc,_callArgs,res,argError))
+		{
+			logger().error("Invalid parameters for method " + lexical_cast<string>(funcNum) + " (" + argError + "): " + string(function));
+			return;
+		}
 	}
 	catch (const ServerShutdownException& e)
 	{
@@ -212,13 +271,22 @@ void HiveExtApp::callExtension( const char* function, char* output, size_t outpu
 		return;
 	}		
 
-	string serializedRes = lexical_cast<string>(res);
-	logger().information("Result: " + serializedRes);
-
-	if (serializedRes.length() >= outputSize)
-		logger().error("Output size too big ("+lexical_cast<string>(serializedRes.length())+") for request : " + string(function));
+	size_t resLen = 0;
+	if (Sqf::WriteValue(res,output,outputSize,resLen))
+		logger().information("Result: " + string(output,resLen));
 	else
-		strncpy_s(output,outputSize,serializedRes.c_str(),outputSize-1);
+	{
+		//only bother building the full string when it's too big to fit
+		string serializedRes = lexical_cast<string>(res);
+		logger().information("Result: " + serializedRes);
+
+		size_t serializedLen = serializedRes.length();
+		UInt32 token = storeContinuation(std::move(serializedRes),outputSize);
+		if (token && Sqf::WriteValue(nextChunk(token),output,outputSize,resLen))
+			logger().information("Result continued (" + lexical_cast<string>(serializedLen) + " total): " + string(output,resLen));
+		else
+			logger().error("Output size too big ("+lexical_cast<string>(serializedLen)+") for request : " + string(function));
+	}
 
 	if (shutdownExc.is_initialized())
 		throw *shutdownExc;
@@ -259,7 +327,7 @@ namespace
 	}
 };
 
-Sqf::Value HiveExtApp::getDateTime( Sqf::Parameters params )
+Sqf::Value HiveExtApp::getDateTime( NoArgs& args )
 {
 	namespace pt=boost::posix_time;
 	pt::ptime now = pt::second_clock::universal_time() + _timeOffset;
@@ -284,16 +352,32 @@ Sqf::Value HiveExtApp::getDateTime( Sqf::Parameters params )
 #include "DataSource/ObjDataSource.h"
 #include <Poco/RandomStream.h>
 
-Sqf::Value HiveExtApp::streamObjects( Sqf::Parameters params )
+Sqf::Value HiveExtApp::streamObjects( StreamObjectsArgs& args )
 {
 	if (_srvObjects.empty())
 	{
 		if (_initKey.length() < 1)
 		{
-			int serverId = boost::get<int>(params.at(0));
+			int serverId = args.get<0>();
 			setServerId(serverId);
 
-			_objData->populateObjects(getServerId(), _srvObjects);
+			//a partial world is worse than none, the server can ask again
+			if (!takePreloadedObjects(getServerId()) && !_objData->populateObjects(getServerId(), _srvObjects))
+			{
+				_srvObjects.clear();
+
+				Sqf::Parameters retVal;
+				retVal.push_back(string("ERROR"));
+				retVal.push_back(string("Failed to load objects"));
+				return retVal;
+			}
+			_objData->useLoadedObjects(getServerId());
+			if (_objectStore)
+			{
+				_objectStore->clear();
+				for (size_t i=0; i<_srvObjects.size(); i++)
+					_objectStore->addStreamed(_srvObjects.rowText(i),_srvObjects.rowLength(i));
+			}
 			//set up initKey
 			{
 				boost::array<UInt8,16> keyData;
@@ -322,212 +406,364 @@ Sqf::Value HiveExtApp::streamObjects( Sqf::Parameters params )
 	}
 	else
 	{
-		Sqf::Parameters retVal = _srvObjects.front();
+		const bool packed = args.get<1>().get_value_or(false);
+		if (packed)
+			return packObjects();
+
+		Sqf::RawValue retVal(string(_srvObjects.frontText(),_srvObjects.frontLength()));
 		_srvObjects.pop();
 
 		return retVal;
 	}
 }
 
-Sqf::Value HiveExtApp::objectInventory( Sqf::Parameters params, bool byUID /*= false*/ )
+#include "Database/Database.h"
+
+void HiveExtApp::startObjectPreload( int serverId, Database* db )
 {
-	Int64 objectIdent = Sqf::GetBigInt(params.at(0));
-	Sqf::Value inventory = boost::get<Sqf::Parameters>(params.at(1));
+	logger().information("Preloading objects for instance " + lexical_cast<string>(serverId));
+
+	_preloadServerId = serverId;
+	_preloadDb = db;
+	_preloadOk = false;
+	_preloadThread.start(_preloadRunner);
+}
+
+void HiveExtApp::preloadObjects()
+{
+	if (_preloadDb)
+		_preloadDb->threadEnter();
+
+	try
+	{
+		if (_objData->populateObjects(_preloadServerId,_preloadedObjects))
+			_preloadOk = true;
+		else
+			_preloadedObjects.clear();
+	}
+	catch (const std::exception& e)
+	{
+		logger().error("Object preload failed: " + string(e.what()));
+		_preloadedObjects.clear();
+	}
+
+	if (_preloadDb)
+		_preloadDb->threadExit();
+}
+
+void HiveExtApp::finishObjectPreload()
+{
+	if (_preloadServerId >= 0)
+		_preloadThread.join();
+}
+
+bool HiveExtApp::takePreloadedObjects( int serverId )
+{
+	if (_preloadServerId < 0)
+		return false;
+
+	finishObjectPreload();
+	const int preloadedId = _preloadServerId;
+	_preloadServerId = -1;
+	if (!_preloadOk)
+		return false;
+
+	if (preloadedId != serverId)
+	{
+		logger().warning("Objects were preloaded for instance " + lexical_cast<string>(preloadedId) + 
+			" but the server is instance " + lexical_cast<string>(serverId) + ", loading them again");
+		_preloadedObjects.clear();
+		return false;
+	}
+
+	_srvObjects.swap(_preloadedObjects);
+	return true;
+}
+
+namespace
+{
+	//longest packed response, not counting the rows themselves
+	const char PACKED_TEMPLATE[] = "[\"OBJS\",4294967295,[]]";
+};
+
+//CHILD:302:SERVERID:true:
+//instead of one row per call, returns as many as fit in the output
+//["OBJS",COUNT,[ROW1,ROW2,...]]
+//with COUNT rows, each row being what a single unpacked call would have returned
+//a row too big to be packed on its own comes back unpacked, like without the flag
+Sqf::Value HiveExtApp::packObjects()
+{
+	const size_t overhead = sizeof(PACKED_TEMPLATE)-1;
+	const size_t budget = (_callOutputSize > overhead+1) ? _callOutputSize-1-overhead : 0;
+
+	//rows are stored serialized, so this is just copying them next to each other
+	size_t count = 0;
+	string rows;
+	rows.reserve(budget);
+	while (!_srvObjects.empty())
+	{
+		size_t sep = (count > 0) ? 1 : 0;
+		if (rows.length()+sep+_srvObjects.frontLength() > budget)
+			break;
+
+		if (sep)
+			rows += ',';
+		rows.append(_srvObjects.frontText(),_srvObjects.frontLength());
+		count++;
+		_srvObjects.pop();
+	}
+
+	if (count < 1)
+	{
+		Sqf::RawValue retVal(string(_srvObjects.frontText(),_srvObjects.frontLength()));
+		_srvObjects.pop();
+
+		return retVal;
+	}
+
+	string packed = "[\"OBJS\"," + lexical_cast<string>(count) + ",[";
+	packed += rows;
+	packed += "]]";
+	return Sqf::RawValue(std::move(packed));
+}
+
+Sqf::Value HiveExtApp::objectInventory( ObjectInventoryArgs& args, bool byUID /*= false*/ )
+{
+	Int64 objectIdent = args.get<0>();
+	string inventory = std::move(args.get<1>().text);
 
 	if (objectIdent != 0) //all the vehicles have objectUID = 0, so it would be bad to update those
+	{
+		if (_objectStore)
+			_objectStore->setInventory(objectIdent,byUID,inventory);
+
 		return ReturnBooleanStatus(_objData->updateObjectInventory(getServerId(),objectIdent,byUID,inventory));
+	}
 
 	return ReturnBooleanStatus(true);
 }
 
-Sqf::Value HiveExtApp::objectDelete( Sqf::Parameters params, bool byUID /*= false*/ )
+Sqf::Value HiveExtApp::objectDelete( ObjectDeleteArgs& args, bool byUID /*= false*/ )
 {
-	Int64 objectIdent = Sqf::GetBigInt(params.at(0));
+	Int64 objectIdent = args.get<0>();
 
 	if (objectIdent != 0) //all the vehicles have objectUID = 0, so it would be bad to delete those
+	{
+		if (_objectStore)
+			_objectStore->remove(objectIdent,byUID);
+
 		return ReturnBooleanStatus(_objData->deleteObject(getServerId(),objectIdent,byUID));
+	}
 
 	return ReturnBooleanStatus(true);
 }
 
-Sqf::Value HiveExtApp::vehicleMoved( Sqf::Parameters params )
+Sqf::Value HiveExtApp::vehicleMoved( VehicleUpdateArgs& args )
 {
-	Int64 objectIdent = Sqf::GetBigInt(params.at(0));
-	Sqf::Value worldspace = boost::get<Sqf::Parameters>(params.at(1));
-	double fuel = Sqf::GetDouble(params.at(2));
+	Int64 objectIdent = args.get<0>();
+	string worldspace = std::move(args.get<1>().text);
+	double fuel = args.get<2>();
 
 	if (objectIdent > 0) //sometimes script sends this with object id 0, which is bad
+	{
+		if (_objectStore)
+			_objectStore->setMovement(objectIdent,worldspace,fuel);
+
 		return ReturnBooleanStatus(_objData->updateVehicleMovement(getServerId(),objectIdent,worldspace,fuel));
+	}
 
 	return ReturnBooleanStatus(true);
 }
 
-Sqf::Value HiveExtApp::vehicleDamaged( Sqf::Parameters params )
+Sqf::Value HiveExtApp::vehicleDamaged( VehicleUpdateArgs& args )
 {
-	Int64 objectIdent = Sqf::GetBigInt(params.at(0));
-	Sqf::Value hitPoints = boost::get<Sqf::Parameters>(params.at(1));
-	double damage = Sqf::GetDouble(params.at(2));
+	Int64 objectIdent = args.get<0>();
+	string hitPoints = std::move(args.get<1>().text);
+	double damage = args.get<2>();
 
 	if (objectIdent > 0) //sometimes script sends this with object id 0, which is bad
+	{
+		if (_objectStore)
+			_objectStore->setStatus(objectIdent,hitPoints,damage);
+
 		return ReturnBooleanStatus(_objData->updateVehicleStatus(getServerId(),objectIdent,hitPoints,damage));
+	}
+
+	return ReturnBooleanStatus(true);
+}
+
+Sqf::Value HiveExtApp::objectPublish( ObjectPublishArgs& args )
+{
+	string className = std::move(args.get<1>());
+	double damage = args.get<2>();
+	int characterId = args.get<3>();
+	string worldSpace = std::move(args.get<4>().text);
+	string inventory = std::move(args.get<5>().text);
+	string hitPoints = std::move(args.get<6>().text);
+	double fuel = args.get<7>();
+	Int64 uniqueId = args.get<8>();
+
+	Int64 objectId = 0;
+	if (!_objData->createObject(getServerId(),className,damage,characterId,worldSpace,inventory,hitPoints,fuel,uniqueId,objectId))
+		return ReturnBooleanStatus(false);
+
+	if (_objectStore)
+		_objectStore->addPublished(objectId,uniqueId,className,characterId,worldSpace,inventory,hitPoints,fuel,damage);
+
+	//the real ObjectID, if it's known already, stringified like in object streaming
+	if (objectId > 0)
+		return ReturnStatus("PASS",lexical_cast<string>(objectId));
 
 	return ReturnBooleanStatus(true);
 }
 
-Sqf::Value HiveExtApp::objectPublish( Sqf::Parameters params )
+//CHILD:311:X:Y:RADIUS:
+//CHILD:312:CHARACTERID:
+//["PASS",[ROW1,ROW2,...]] with rows as described in ObjectStore.h
+Sqf::Value HiveExtApp::objectsNear( ObjectsNearArgs& args )
 {
-	string className = boost::get<string>(params.at(1));
-	double damage = Sqf::GetDouble(params.at(2));
-	int characterId = Sqf::GetIntAny(params.at(3));
-	Sqf::Value worldSpace = boost::get<Sqf::Parameters>(params.at(4));
-	Sqf::Value inventory = boost::get<Sqf::Parameters>(params.at(5));
-	Sqf::Value hitPoints = boost::get<Sqf::Parameters>(params.at(6));
-	double fuel = Sqf::GetDouble(params.at(7));
-	Int64 uniqueId = Sqf::GetBigInt(params.at(8));
-
-	return ReturnBooleanStatus(_objData->createObject(getServerId(),className,damage,characterId,worldSpace,inventory,hitPoints,fuel,uniqueId));
+	if (!_objectStore)
+		return ReturnBooleanStatus(false,"Object store not enabled");
+
+	return ReturnStatus("PASS",Sqf::Value(_objectStore->findInRadius(args.get<0>(),args.get<1>(),args.get<2>())));
+}
+
+Sqf::Value HiveExtApp::objectsOwned( ObjectsOwnedArgs& args )
+{
+	if (!_objectStore)
+		return ReturnBooleanStatus(false,"Object store not enabled");
+
+	return ReturnStatus("PASS",Sqf::Value(_objectStore->findByOwner(args.get<0>())));
+}
+
+//CHILD:313:CURSOR:
+//["PASS",NEWCURSOR,[ROW1,ROW2,...],["ID1","ID2",...]]
+//rows of objects inserted or changed since CURSOR (0 or nothing for everything since they were loaded),
+//in the same form as when streaming, followed by ObjectIDs of objects that were deleted
+//only the latest state of each object is returned, NEWCURSOR goes into the next call
+Sqf::Value HiveExtApp::objectChanges( ObjectChangesArgs& args )
+{
+	UInt32 cursor = static_cast<UInt32>(args.get<0>().get_value_or(0));
+	vector<string> rows;
+	vector<Int64> uniqueIds;
+	vector<int> deletedIds;
+	if (!_objData->fetchObjectChanges(cursor,rows,uniqueIds,deletedIds))
+		return ReturnBooleanStatus(false,"Object changes not followed");
+
+	string rowsText = "[";
+	for (auto it=rows.begin(); it!=rows.end(); ++it)
+	{
+		if (it != rows.begin())
+			rowsText += ',';
+		rowsText += *it;
+
+		if (_objectStore)
+			_objectStore->addStreamed(it->c_str(),it->length(),uniqueIds[it-rows.begin()]);
+	}
+	rowsText += "]";
+
+	Sqf::Parameters deleted;
+	for (auto it=deletedIds.begin(); it!=deletedIds.end(); ++it)
+	{
+		deleted.push_back(lexical_cast<string>(*it));
+		if (_objectStore)
+			_objectStore->remove(*it,false);
+	}
+
+	Sqf::Parameters retVal;
+	retVal.push_back(string("PASS"));
+	retVal.push_back(static_cast<Int64>(cursor));
+	retVal.push_back(Sqf::RawValue(std::move(rowsText)));
+	retVal.push_back(deleted);
+	return retVal;
 }
 
 #include "DataSource/CharDataSource.h"
 
-Sqf::Value HiveExtApp::loadPlayer( Sqf::Parameters params )
+Sqf::Value HiveExtApp::loadPlayer( LoadPlayerArgs& args )
 {
-	string playerId = Sqf::GetStringAny(params.at(0));
-	string playerName = Sqf::GetStringAny(params.at(2));
+	string playerId = std::move(args.get<0>().str);
+	string playerName = std::move(args.get<2>().str);
 
 	return _charData->fetchCharacterInitial(playerId,getServerId(),playerName);
 }
 
-Sqf::Value HiveExtApp::loadCharacterDetails( Sqf::Parameters params )
+Sqf::Value HiveExtApp::loadCharacterDetails( CharacterArgs& args )
 {
-	int characterId = Sqf::GetIntAny(params.at(0));
+	int characterId = args.get<0>();
 	
 	return _charData->fetchCharacterDetails(characterId);
 }
 
-Sqf::Value HiveExtApp::recordCharacterLogin( Sqf::Parameters params )
+Sqf::Value HiveExtApp::recordCharacterLogin( CharacterLoginArgs& args )
 {
-	string playerId = Sqf::GetStringAny(params.at(0));
-	int characterId = Sqf::GetIntAny(params.at(1));
-	int action = Sqf::GetIntAny(params.at(2));
+	string playerId = std::move(args.get<0>().str);
+	int characterId = args.get<1>();
+	int action = args.get<2>();
 
 	return ReturnBooleanStatus(_charData->recordLogin(playerId,characterId,action));
 }
 
-Sqf::Value HiveExtApp::playerUpdate( Sqf::Parameters params )
+Sqf::Value HiveExtApp::playerUpdate( PlayerUpdateArgs& args )
 {
-	int characterId = Sqf::GetIntAny(params.at(0));
+	int characterId = args.get<0>();
+	PlayerStatsArgs::inherited& stats = args.get<7>();
 	CharDataSource::FieldsType fields;
 
-	try
+	//old scripts send fewer fields, empty and any ones still count as sent
+	//_callArgs are the arguments of this call, batched calls (600) set them for each call in the batch
+	if (_callArgs.size() < 16)
+		logger().warning("Update of character " + lexical_cast<string>(characterId) + " only had " + lexical_cast<string>(_callArgs.size()) + " parameters out of 16");
+
+	if (args.get<1>() && args.get<1>()->size() > 0)
+		fields["Worldspace"] = std::move(*args.get<1>());
+	if (args.get<2>() && args.get<2>()->size() > 0)
+		fields["Inventory"] = std::move(*args.get<2>());
+	if (args.get<3>() && args.get<3>()->size() > 0)
+		fields["Backpack"] = std::move(*args.get<3>());
+	if (args.get<4>() && args.get<4>()->size() > 0)
 	{
-		if (!Sqf::IsNull(params.at(1)))
+		Sqf::Parameters& medicalArr = *args.get<4>();
+		for (size_t i=0;i<medicalArr.size();i++)
 		{
-			Sqf::Parameters worldSpaceArr = boost::get<Sqf::Parameters>(params.at(1));
-			if (worldSpaceArr.size() > 0)
+			if (Sqf::IsAny(medicalArr[i]))
 			{
-				Sqf::Value worldSpace = worldSpaceArr;
-				fields["Worldspace"] = worldSpace;
+				logger().warning("update.medical["+lexical_cast<string>(i)+"] changed from any to []");
+				medicalArr[i] = Sqf::Parameters();
 			}
 		}
-		if (!Sqf::IsNull(params.at(2)))
-		{
-			Sqf::Parameters inventoryArr = boost::get<Sqf::Parameters>(params.at(2));
-			if (inventoryArr.size() > 0)
-			{
-				Sqf::Value inventory = inventoryArr;
-				fields["Inventory"] = inventory;
-			}
-		}
-		if (!Sqf::IsNull(params.at(3)))
-		{
-			Sqf::Parameters backpackArr = boost::get<Sqf::Parameters>(params.at(3));
-			if (backpackArr.size() > 0)
-			{
-				Sqf::Value backpack = backpackArr;
-				fields["Backpack"] = backpack;
-			}
-		}
-		if (!Sqf::IsNull(params.at(4)))
-		{
-			Sqf::Parameters medicalArr = boost::get<Sqf::Parameters>(params.at(4));
-			if (medicalArr.size() > 0)
-			{
-				for (size_t i=0;i<medicalArr.size();i++)
-				{
-					if (Sqf::IsAny(medicalArr[i]))
-					{
-						logger().warning("update.medical["+lexical_cast<string>(i)+"] changed from any to []");
-						medicalArr[i] = Sqf::Parameters();
-					}
-				}
-				Sqf::Value medical = medicalArr;
-				fields["Medical"] = medical;
-			}
-		}
-		if (!Sqf::IsNull(params.at(5)))
-		{
-			bool justAte = boost::get<bool>(params.at(5));
-			if (justAte) fields["JustAte"] = true;
-		}
-		if (!Sqf::IsNull(params.at(6)))
-		{
-			bool justDrank = boost::get<bool>(params.at(6));
-			if (justDrank) fields["JustDrank"] = true;
-		}
-		if (!Sqf::IsNull(params.at(7)))
-		{
-			int moreKillsZ = boost::get<int>(params.at(7));
-			if (moreKillsZ > 0) fields["KillsZ"] = moreKillsZ;
-		}
-		if (!Sqf::IsNull(params.at(8)))
-		{
-			int moreKillsH = boost::get<int>(params.at(8));
-			if (moreKillsH > 0) fields["HeadshotsZ"] = moreKillsH;
-		}
-		if (!Sqf::IsNull(params.at(9)))
-		{
-			int distanceWalked = static_cast<int>(Sqf::GetDouble(params.at(9)));
-			if (distanceWalked > 0) fields["DistanceFoot"] = distanceWalked;
-		}
-		if (!Sqf::IsNull(params.at(10)))
-		{
-			int durationLived = static_cast<int>(Sqf::GetDouble(params.at(10)));
-			if (durationLived > 0) fields["Duration"] = durationLived;
-		}
-		if (!Sqf::IsNull(params.at(11)))
-		{
-			Sqf::Parameters currentStateArr = boost::get<Sqf::Parameters>(params.at(11));
-			if (currentStateArr.size() > 0)
-			{
-				Sqf::Value currentState = currentStateArr;
-				fields["CurrentState"] = currentState;
-			}
-		}
-		if (!Sqf::IsNull(params.at(12)))
-		{
-			int moreKillsHuman = boost::get<int>(params.at(12));
-			if (moreKillsHuman > 0) fields["KillsH"] = moreKillsHuman;
-		}
-		if (!Sqf::IsNull(params.at(13)))
-		{
-			int moreKillsBandit = boost::get<int>(params.at(13));
-			if (moreKillsBandit > 0) fields["KillsB"] = moreKillsBandit;
-		}
-		if (!Sqf::IsNull(params.at(14)))
-		{
-			string newModel = boost::get<string>(params.at(14));
-			fields["Model"] = newModel;
-		}
-		if (!Sqf::IsNull(params.at(15)))
-		{
-			int humanityDiff = static_cast<int>(Sqf::GetDouble(params.at(15)));
-			if (humanityDiff != 0) fields["Humanity"] = humanityDiff;
-		}
+		fields["Medical"] = std::move(medicalArr);
+	}
+	if (args.get<5>() && *args.get<5>())
+		fields["JustAte"] = true;
+	if (args.get<6>() && *args.get<6>())
+		fields["JustDrank"] = true;
+	if (stats.get<0>() && *stats.get<0>() > 0)
+		fields["KillsZ"] = *stats.get<0>();
+	if (stats.get<1>() && *stats.get<1>() > 0)
+		fields["HeadshotsZ"] = *stats.get<1>();
+	if (stats.get<2>())
+	{
+		int distanceWalked = static_cast<int>(*stats.get<2>());
+		if (distanceWalked > 0) fields["DistanceFoot"] = distanceWalked;
 	}
-	catch (const std::out_of_range&)
+	if (stats.get<3>())
 	{
-		logger().warning("Update of character " + lexical_cast<string>(characterId) + " only had " + lexical_cast<string>(params.size()) + " parameters out of 16");
+		int durationLived = static_cast<int>(*stats.get<3>());
+		if (durationLived > 0) fields["Duration"] = durationLived;
+	}
+	if (stats.get<4>() && stats.get<4>()->size() > 0)
+		fields["CurrentState"] = std::move(*stats.get<4>());
+	if (stats.get<5>() && *stats.get<5>() > 0)
+		fields["KillsH"] = *stats.get<5>();
+	if (stats.get<6>() && *stats.get<6>() > 0)
+		fields["KillsB"] = *stats.get<6>();
+	if (stats.get<7>())
+		fields["Model"] = std::move(*stats.get<7>());
+	if (stats.get<8>())
+	{
+		int humanityDiff = static_cast<int>(*stats.get<8>());
+		if (humanityDiff != 0) fields["Humanity"] = humanityDiff;
 	}
 
 	if (fields.size() > 0)
@@ -536,19 +772,19 @@ Sqf::Value HiveExtApp::playerUpdate( Sqf::Parameters params )
 	return ReturnBooleanStatus(true);
 }
 
-Sqf::Value HiveExtApp::playerInit( Sqf::Parameters params )
+Sqf::Value HiveExtApp::playerInit( PlayerInitArgs& args )
 {
-	int characterId = Sqf::GetIntAny(params.at(0));
-	Sqf::Value inventory = boost::get<Sqf::Parameters>(params.at(1));
-	Sqf::Value backpack = boost::get<Sqf::Parameters>(params.at(2));
+	int characterId = args.get<0>();
+	Sqf::Value inventory = std::move(args.get<1>());
+	Sqf::Value backpack = std::move(args.get<2>());
 
 	return ReturnBooleanStatus(_charData->initCharacter(characterId,inventory,backpack));
 }
 
-Sqf::Value HiveExtApp::playerDeath( Sqf::Parameters params )
+Sqf::Value HiveExtApp::playerDeath( PlayerDeathArgs& args )
 {
-	int characterId = Sqf::GetIntAny(params.at(0));
-	int duration = static_cast<int>(Sqf::GetDouble(params.at(1)));
+	int characterId = args.get<0>();
+	int duration = static_cast<int>(args.get<1>());
 	
 	return ReturnBooleanStatus(_charData->killCharacter(characterId,duration));
 }
@@ -639,27 +875,21 @@ namespace
 		return token;
 	}
 
-	UInt32 FetchToken(const Sqf::Parameters& params)
+	UInt32 FetchToken(const boost::optional<Sqf::StringAny>& tokenStr)
 	{
+		//doesn't even exist
+		if (!tokenStr)
+			return 0;
+
 		try
 		{
-			return HexToToken(Sqf::GetStringAny(params.at(0)));
+			return HexToToken(tokenStr->str);
 		}
 		catch(const boost::bad_lexical_cast&)
 		{
 			//invalid characters in string
 			return 0;
 		}
-		catch(const boost::bad_get&)
-		{
-			//not a string
-			return 0;
-		}
-		catch(const std::out_of_range&)
-		{
-			//doesn't even exist
-			return 0;
-		}
 	}
 };
 
@@ -692,7 +922,7 @@ namespace
 
 //The return value is either ["PASS",UNIQID] where UNIQID represents the string token that you can later use to retrieve results
 //or ["ERROR",ERRORDESCR] where ERRORDESCR is a description of the error that happened
-Sqf::Value HiveExtApp::dataRequest( Sqf::Parameters params, bool async )
+Sqf::Value HiveExtApp::dataRequest( DataRequestArgs& args, bool async )
 {
 	auto retErr = [](string errMsg) -> Sqf::Value
 	{
@@ -700,32 +930,11 @@ Sqf::Value HiveExtApp::dataRequest( Sqf::Parameters params, bool async )
 		return errRtn;
 	};
 
-	auto tableName = boost::get<string>(params.at(0));
-	vector<string> fields;
-	{
-		int currIdx = -1;
-		try
-		{
-			const auto& sqfFields = boost::get<Sqf::Parameters>(params.at(1));
-			fields.reserve(sqfFields.size());
-			for (size_t i=0; i<sqfFields.size(); i++)
-			{
-				currIdx++;
-				fields.push_back(boost::get<string>(sqfFields[i]));
-			}
-		}
-		catch(const boost::bad_get&)
-		{
-			string errorMsg;
-			if (currIdx < 0)
-				errorMsg = "FIELDS not an array";
-			else
-				errorMsg = "FIELDS[" + boost::lexical_cast<string>(currIdx) + "] not a string";
-		}
-	}
+	const string& tableName = args.get<0>();
+	const vector<string>& fields = args.get<1>();
 	vector<CustomDataSource::WhereElem> where;
 	{
-		const auto& whereSqfArr = boost::get<Sqf::Parameters>(params.at(2));
+		const Sqf::Parameters& whereSqfArr = args.get<2>();
 		for (size_t i=0; i<whereSqfArr.size(); i++)
 		{
 			try
@@ -748,17 +957,18 @@ Sqf::Value HiveExtApp::dataRequest( Sqf::Parameters params, bool async )
 	Int64 limitCount = -1;
 	Int64 limitOffset = 0;
 
-	if (params.size() >= 4)
+	if (args.get<3>())
 	{
+		const Sqf::Value& limitVal = *args.get<3>();
 		try
 		{
-			limitCount = Sqf::GetBigInt(params[3]);
+			limitCount = Sqf::GetBigInt(limitVal);
 		}
 		catch (const boost::bad_get&)
 		{
 			try
 			{
-				const auto& limitArr = boost::get<Sqf::Parameters>(params[3]);
+				const auto& limitArr = boost::get<Sqf::Parameters>(limitVal);
 				if (limitArr.size() < 2)
 					throw boost::bad_get();
 
@@ -767,7 +977,7 @@ Sqf::Value HiveExtApp::dataRequest( Sqf::Parameters params, bool async )
 			}
 			catch (const boost::bad_get&)
 			{
-				string errorMsg = "LIMIT in invalid format: '"+boost::lexical_cast<string>(params[3])+"'";
+				string errorMsg = "LIMIT in invalid format: '"+boost::lexical_cast<string>(limitVal)+"'";
 				return retErr(errorMsg);
 			}
 		}
@@ -826,9 +1036,9 @@ namespace
 //if you get this result, the UNIQID will not be usable anymore (not even for status)
 //"UNKID" = unknown UNIQID specified, or it has been cleared (by fetching ERROR status or last row)
 //additiionally, if isInvalidId is set to true, then the UNIQID is malformed/missing and would never have worked
-Sqf::Value HiveExtApp::dataStatus( Sqf::Parameters params )
+Sqf::Value HiveExtApp::dataStatus( TokenArgs& args )
 {
-	UInt32 token = FetchToken(params);
+	UInt32 token = FetchToken(args.get<0>());
 	if (!token)
 		return ReturnBadToken();
 	
@@ -871,9 +1081,9 @@ Sqf::Value HiveExtApp::dataStatus( Sqf::Parameters params )
 //indicates that the result set rows have been exhausted
 //no actual field values are returned, just a marker to let you know that you should stop
 //and close the request
-Sqf::Value HiveExtApp::dataFetchRow( Sqf::Parameters params )
+Sqf::Value HiveExtApp::dataFetchRow( TokenArgs& args )
 {
-	UInt32 token = FetchToken(params);
+	UInt32 token = FetchToken(args.get<0>());
 	if (!token)
 		return ReturnBadToken();
 
@@ -910,9 +1120,9 @@ Sqf::Value HiveExtApp::dataFetchRow( Sqf::Parameters params )
 //closes a retrieved request or cancels a pending one
 //returns PASS if it was closed/cancelled
 //returns UNKID if the UNIQID was already closed/bad
-Sqf::Value HiveExtApp::dataClose( Sqf::Parameters params )
+Sqf::Value HiveExtApp::dataClose( TokenArgs& args )
 {
-	UInt32 token = FetchToken(params);
+	UInt32 token = FetchToken(args.get<0>());
 	if (!token)
 		return ReturnBadToken();
 
@@ -923,6 +1133,89 @@ Sqf::Value HiveExtApp::dataClose( Sqf::Parameters params )
 		return ReturnBadToken(false);
 }
 
+#include <algorithm>
+
+namespace
+{
+	//longest chunk response, not counting the quoted text itself
+	const char CHUNK_TEMPLATE[] = "[\"CHUNK\",\"00000000\",false,\"\"]";
+	//chunk text needs at least this much room to be worth it
+	const size_t MIN_CHUNK_BUDGET = 64;
+	//results that are never fetched entirely get dropped, oldest first
+	const size_t MAX_CONTINUATIONS = 64;
+};
+
+UInt32 HiveExtApp::storeContinuation( string text, size_t outputSize )
+{
+	const size_t overhead = sizeof(CHUNK_TEMPLATE)-1;
+	if (outputSize < overhead+1+MIN_CHUNK_BUDGET)
+		return 0;
+
+	while (_continuations.size() >= MAX_CONTINUATIONS)
+	{
+		UInt32 oldest = _continuationOrder.front();
+		_continuationOrder.pop_front();
+		logger().warning("Dropping unfinished result " + TokenToHex(oldest));
+		_continuations.erase(oldest);
+	}
+
+	//after wrapping around, tokens still in use are skipped
+	do
+	{
+		if (++_lastContinuation == 0)
+			_lastContinuation = 1;
+	}
+	while (_continuations.count(_lastContinuation) > 0);
+
+	_continuationOrder.push_back(_lastContinuation);
+	Continuation& cont = _continuations[_lastContinuation];
+	cont.text = boost::make_shared<string>(std::move(text));
+	cont.offset = 0;
+	cont.budget = outputSize-1-overhead;
+
+	return _lastContinuation;
+}
+
+Sqf::Value HiveExtApp::nextChunk( UInt32 token )
+{
+	auto it = _continuations.find(token);
+	if (it == _continuations.end())
+		return ReturnBadToken(false);
+
+	Continuation& cont = it->second;
+	Sqf::Parameters retVal;
+	retVal.push_back(string("CHUNK"));
+	retVal.push_back(TokenToHex(token));
+	Sqf::RawValue slice = Sqf::QuoteSlice(*cont.text,cont.offset,cont.budget);
+	bool more = (cont.offset < cont.text->length());
+	retVal.push_back(more);
+	retVal.push_back(std::move(slice));
+
+	if (!more)
+	{
+		_continuations.erase(it);
+		_continuationOrder.erase(std::find(_continuationOrder.begin(),_continuationOrder.end(),token));
+	}
+
+	return retVal;
+}
+
+//CHILD:601:UNIQID:
+//results that don't fit in the output buffer come back as
+//["CHUNK",UNIQID,MORE,TEXT]
+//where TEXT is the next piece of the serialized result, as a string
+//and MORE is true when there are more pieces left, which are retrieved by calling 601 with the UNIQID
+//concatenating all the TEXT pieces and compiling that gives the original result
+//["UNKID",isInvalidId] is returned when the UNIQID is malformed, or unknown/finished
+Sqf::Value HiveExtApp::continueResult( TokenArgs& args )
+{
+	UInt32 token = FetchToken(args.get<0>());
+	if (!token)
+		return ReturnBadToken();
+
+	return nextChunk(token);
+}
+
 namespace
 {
 	struct TableVisitor : public boost::static_visitor<void>
@@ -965,11 +1258,11 @@ namespace
 //["PASS",DUPLICATEALLOWED,REMOVEMISSING]
 //where DUPLICATEALLOWED is an array of tables which you have now allowed, but were allowed anyway
 //and REMOVEMISSING is an array of tables which you wanted to remove from the allow list, but they weren't there
-Sqf::Value HiveExtApp::changeTableAccess( Sqf::Parameters params )
+Sqf::Value HiveExtApp::changeTableAccess( TableAccessArgs& args )
 {
 	//check key
 	{
-		string theirKey = boost::get<string>(params.at(0));
+		const string& theirKey = args.get<0>();
 		if (!_initKey.length() || _initKey != theirKey)
 			return ReturnBooleanStatus(false,"Invalid key");
 	}
@@ -980,18 +1273,18 @@ Sqf::Value HiveExtApp::changeTableAccess( Sqf::Parameters params )
 	const char* currThing;
 	try
 	{
-		if (params.size() >= 2)
+		if (args.get<1>())
 		{
 			currThing = "ALLOWTABLES";
 			visitor = TableVisitor();
-			boost::apply_visitor(visitor,params[1]);
+			boost::apply_visitor(visitor,*args.get<1>());
 			allowTables = visitor.collection;
 		}
-		if (params.size() >= 3)
+		if (args.get<2>())
 		{
 			currThing = "REMOVEALLOWTABLES";
 			visitor = TableVisitor();
-			boost::apply_visitor(visitor,params[2]);
+			boost::apply_visitor(visitor,*args.get<2>());
 			removeTables = visitor.collection;
 		}
 	}
@@ -1069,16 +1362,99 @@ Sqf::Value HiveExtApp::changeTableAccess( Sqf::Parameters params )
 	return ReturnStatus("PASS",retVal);
 }
 
+//CHILD:600:[[METHODID,PARAM1,PARAM2,...],[METHODID,...],...]:
+//calls each of the methods in order, as if they were separate requests
+//the return value is ["PASS",[RESULT1,RESULT2,...]] with one result per call, in the same order
+//a call that couldn't be made (malformed, unknown method, bad parameters, error while executing)
+//gets ["ERROR",ERRORDESCR] as its result, the other calls go ahead regardless
+//batches can't be nested, and 399 (shutdown) can't be batched
+Sqf::Value HiveExtApp::batchCall( BatchArgs& args )
+{
+	const size_t batchNode = args.get<0>().node;
+
+	Sqf::Parameters results;
+	results.reserve(_callDoc.size(batchNode));
+	for (size_t call=_callDoc.first(batchNode);call!=_callDoc.next(batchNode);call=_callDoc.next(call))
+	{
+		Sqf::Value res;
+		string callError;
+		if (!batchedMethod(call,res,callError))
+		{
+			logger().error("Batched call " + lexical_cast<string>(results.size()) + " failed: " + callError);
+			res = ReturnBooleanStatus(false,std::move(callError));
+		}
+		results.push_back(std::move(res));
+	}
+
+	return ReturnStatus("PASS",Sqf::Value(std::move(results)));
+}
+
+bool HiveExtApp::batchedMethod( size_t callNode, Sqf::Value& result, string& error )
+{
+	if (_callDoc.type(callNode) != Sqf::Document::TYPE_ARRAY || _callDoc.size(callNode) < 1)
+	{
+		error = "Call is not a [METHODID,...] array";
+		return false;
+	}
+
+	size_t funcIdent = _callDoc.first(callNode);
+	int funcNum = -1;
+	if (_callDoc.type(funcIdent) == Sqf::Document::TYPE_INT)
+		funcNum = _callDoc.getIntAny(funcIdent);
+
+	if (funcNum < 0 || static_cast<size_t>(funcNum) >= methods.size() || methods[funcNum].empty())
+	{
+		error = "Invalid method id: " + _callDoc.toString(funcIdent);
+		return false;
+	}
+	if (funcNum == 600 || funcNum == 399)
+	{
+		error = "Method " + lexical_cast<string>(funcNum) + " can't be batched";
+		return false;
+	}
+
+	//the batch itself has been decoded already, so the call arguments can be reused
+	//(handlers that look at how many arguments they got see the right number)
+	_callArgs.clear();
+	for (size_t arg=_callDoc.next(funcIdent);arg!=_callDoc.next(callNode);arg=_callDoc.next(arg))
+		_callArgs.push_back(arg);
+
+	string argError;
+	try
+	{
+		if (!methods[funcNum](_callDoc,_callArgs,result,argError))
+		{
+			error = "Invalid parameters for method " + lexical_cast<string>(funcNum) + " (" + argError + ")";
+			return false;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		error = "Error executing method " + lexical_cast<string>(funcNum) + ": " + e.what();
+		return false;
+	}
+	catch (...)
+	{
+		error = "Error executing method " + lexical_cast<string>(funcNum);
+		return false;
+	}
+
+	return true;
+}
+
 //CHILD:399:SUPERKEY:
 //if the SUPERKEY matches, HiveExt instance will shut down
 //and ["PASS"] will be returned
 //otherwise, ["ERROR"] will be returned
-Sqf::Value HiveExtApp::serverShutdown( Sqf::Parameters params )
+Sqf::Value HiveExtApp::serverShutdown( KeyArgs& args )
 {
-	string theirKey = boost::get<string>(params.at(0));
+	const string& theirKey = args.get<0>();
 	if ((_initKey.length() > 0) && (theirKey == _initKey))
 	{
 		logger().information("Shutting down HiveExt instance");
+		//held back updates are queued before anything gets shut down
+		_charData->flushWrites();
+		_objData->flushWrites();
 		throw ServerShutdownException(theirKey,ReturnBooleanStatus(true));
 	}
 
@@ -22,6 +22,8 @@
 #include "Shared/Server/AppServer.h"
 
 #include "Sqf.h"
+#include "SqfArgs.h"
+#include "ObjectStore.h"
 #include "DataSource/CharDataSource.h"
 #include "DataSource/ObjDataSource.h"
 #include "DataSource/CustomDataSource.h"
@@ -29,6 +31,9 @@
 #include <boost/function.hpp>
 #include <boost/date_time.hpp>
 
+#include <Poco/RunnableAdapter.h>
+#include <Poco/Thread.h>
+
 class Database;
 class HiveExtApp: public AppServer
 {
@@ -56,47 +61,124 @@ protected:
 
 	virtual bool initialiseService() = 0;
 protected:
+	//loads the objects of that instance in the background, the first 302 for it picks them up
+	//db is the database the objects come from, as it's used from another thread
+	void startObjectPreload(int serverId, Database* db);
+	//waits for the preload (if any) to be done, has to happen before the datasources go away
+	void finishObjectPreload();
+
 	void setServerId(int newId) { _serverId = newId; }
 	int getServerId() const { return _serverId; }
 
 	unique_ptr<CharDataSource> _charData;
 	unique_ptr<ObjDataSource> _objData;
 	unique_ptr<CustomDataSource> _customData;
+	//only there if it's enabled
+	unique_ptr<ObjectStore> _objectStore;
 
 	string _initKey;
 private:
 	int _serverId;
 	boost::posix_time::time_duration _timeOffset;
 	void setupClock();
+	void setupNumberFormat();
 
-	typedef boost::function<Sqf::Value (Sqf::Parameters)> HandlerFunc;
-	map<int,HandlerFunc> handlers;
-
-	Sqf::Value getDateTime(Sqf::Parameters params);
-
-	ObjDataSource::ServerObjectsQueue _srvObjects;
-	Sqf::Value streamObjects(Sqf::Parameters params);
+	//methods are looked up by id, each one decodes its arguments into the signature it was registered with
+	//false means the arguments didn't fit, the string then says which one and why
+	typedef boost::function<bool (const Sqf::Document&, const Sqf::DocArgs&, Sqf::Value&, string&)> MethodFunc;
+	vector<MethodFunc> methods;
+	template<typename Signature>
+	void registerMethod(int methodId, boost::function<Sqf::Value (Signature&)> func);
 
-	Sqf::Value objectPublish(Sqf::Parameters params);
-	Sqf::Value objectInventory(Sqf::Parameters params, bool byUID = false);
-	Sqf::Value objectDelete(Sqf::Parameters params, bool byUID = false);
+	Sqf::Document _callDoc;
+	Sqf::DocArgs _callArgs;
+	size_t _callOutputSize;
 
-	Sqf::Value vehicleMoved(Sqf::Parameters params);
-	Sqf::Value vehicleDamaged(Sqf::Parameters params);
+	//method signatures, handlers are free to move things out of their arguments
+	typedef boost::tuple<> NoArgs;
+	typedef boost::tuple<string> KeyArgs;
+	typedef boost::tuple<boost::optional<Sqf::StringAny>> TokenArgs;
 
-	Sqf::Value loadPlayer(Sqf::Parameters params);
-	Sqf::Value loadCharacterDetails(Sqf::Parameters params);
-	Sqf::Value recordCharacterLogin(Sqf::Parameters params);
+	Sqf::Value getDateTime(NoArgs& args);
 
-	Sqf::Value playerUpdate(Sqf::Parameters params);
-	Sqf::Value playerInit(Sqf::Parameters params);
-	Sqf::Value playerDeath(Sqf::Parameters params);
-
-	Sqf::Value dataRequest(Sqf::Parameters params, bool async = false);
-	Sqf::Value dataStatus(Sqf::Parameters params);
-	Sqf::Value dataFetchRow(Sqf::Parameters params);
-	Sqf::Value dataClose(Sqf::Parameters params);
+	ObjDataSource::ServerObjectsQueue _srvObjects;
 
-	Sqf::Value changeTableAccess(Sqf::Parameters params);
-	Sqf::Value serverShutdown(Sqf::Parameters params);
+	ObjDataSource::ServerObjectsQueue _preloadedObjects;
+	int _preloadServerId;
+	Database* _preloadDb;
+	volatile bool _preloadOk;
+	Poco::Thread _preloadThread;
+	Poco::RunnableAdapter<HiveExtApp> _preloadRunner;
+	void preloadObjects();
+	//true if the preloaded objects were for serverId, and got moved into _srvObjects
+	bool takePreloadedObjects(int serverId);
+
+	typedef boost::tuple<int,boost::optional<bool>> StreamObjectsArgs;
+	Sqf::Value streamObjects(StreamObjectsArgs& args);
+	Sqf::Value packObjects();
+
+	typedef boost::tuple<Sqf::Ignored,string,double,int,Sqf::ArrayText,Sqf::ArrayText,Sqf::ArrayText,double,Int64> ObjectPublishArgs;
+	Sqf::Value objectPublish(ObjectPublishArgs& args);
+	typedef boost::tuple<Int64,Sqf::ArrayText> ObjectInventoryArgs;
+	Sqf::Value objectInventory(ObjectInventoryArgs& args, bool byUID = false);
+	typedef boost::tuple<Int64> ObjectDeleteArgs;
+	Sqf::Value objectDelete(ObjectDeleteArgs& args, bool byUID = false);
+
+	typedef boost::tuple<Int64,Sqf::ArrayText,double> VehicleUpdateArgs;
+	Sqf::Value vehicleMoved(VehicleUpdateArgs& args);
+	Sqf::Value vehicleDamaged(VehicleUpdateArgs& args);
+
+	typedef boost::tuple<double,double,double> ObjectsNearArgs;
+	Sqf::Value objectsNear(ObjectsNearArgs& args);
+	typedef boost::tuple<int> ObjectsOwnedArgs;
+	Sqf::Value objectsOwned(ObjectsOwnedArgs& args);
+	typedef boost::tuple<boost::optional<Int64>> ObjectChangesArgs;
+	Sqf::Value objectChanges(ObjectChangesArgs& args);
+
+	typedef boost::tuple<Sqf::StringAny,Sqf::Ignored,Sqf::StringAny> LoadPlayerArgs;
+	Sqf::Value loadPlayer(LoadPlayerArgs& args);
+	typedef boost::tuple<int> CharacterArgs;
+	Sqf::Value loadCharacterDetails(CharacterArgs& args);
+	typedef boost::tuple<Sqf::StringAny,int,int> CharacterLoginArgs;
+	Sqf::Value recordCharacterLogin(CharacterLoginArgs& args);
+
+	//more than a tuple can hold, the stats continue in a nested list
+	typedef boost::tuple<boost::optional<int>,boost::optional<int>,boost::optional<double>,boost::optional<double>,
+		boost::optional<Sqf::Parameters>,boost::optional<int>,boost::optional<int>,boost::optional<string>,boost::optional<double>> PlayerStatsArgs;
+	typedef boost::tuple<int,boost::optional<Sqf::Parameters>,boost::optional<Sqf::Parameters>,boost::optional<Sqf::Parameters>,
+		boost::optional<Sqf::Parameters>,boost::optional<bool>,boost::optional<bool>,PlayerStatsArgs::inherited> PlayerUpdateArgs;
+	Sqf::Value playerUpdate(PlayerUpdateArgs& args);
+	typedef boost::tuple<int,Sqf::Parameters,Sqf::Parameters> PlayerInitArgs;
+	Sqf::Value playerInit(PlayerInitArgs& args);
+	typedef boost::tuple<int,double> PlayerDeathArgs;
+	Sqf::Value playerDeath(PlayerDeathArgs& args);
+
+	typedef boost::tuple<string,vector<string>,Sqf::Parameters,boost::optional<Sqf::Value>> DataRequestArgs;
+	Sqf::Value dataRequest(DataRequestArgs& args, bool async = false);
+	Sqf::Value dataStatus(TokenArgs& args);
+	Sqf::Value dataFetchRow(TokenArgs& args);
+	Sqf::Value dataClose(TokenArgs& args);
+
+	//results too big for the output buffer are kept here and handed out in pieces (601)
+	struct Continuation
+	{
+		shared_ptr<const string> text;
+		size_t offset;
+		size_t budget; //how much quoted text fits in one chunk
+	};
+	map<UInt32,Continuation> _continuations;
+	//tokens in the order they were handed out, tokens wrap around so their value says nothing about age
+	deque<UInt32> _continuationOrder;
+	UInt32 _lastContinuation;
+	UInt32 storeContinuation(string text, size_t outputSize);
+	Sqf::Value nextChunk(UInt32 token);
+	Sqf::Value continueResult(TokenArgs& args);
+
+	typedef boost::tuple<Sqf::ArrayNode> BatchArgs;
+	Sqf::Value batchCall(BatchArgs& args);
+	bool batchedMethod(size_t callNode, Sqf::Value& result, string& error);
+
+	typedef boost::tuple<string,boost::optional<Sqf::Value>,boost::optional<Sqf::Value>> TableAccessArgs;
+	Sqf::Value changeTableAccess(TableAccessArgs& args);
+	Sqf::Value serverShutdown(KeyArgs& args);
 };
\ No newline at end of file
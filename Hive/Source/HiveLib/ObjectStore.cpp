@@ -0,0 +1,360 @@
+/*
+* Copyright (C) 2009-2013 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "ObjectStore.h"
+
+#include <boost/lexical_cast.hpp>
+using boost::lexical_cast;
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	//no map comes close, anything past it (or not a number at all) is treated as having no position
+	const double WORLD_EXTENT = 10000000.0;
+
+	bool InWorld(double coord) { return coord >= -WORLD_EXTENT && coord <= WORLD_EXTENT; }
+
+	//[dir,[x,y,z]]
+	bool ReadPosition(const Sqf::Document& doc, size_t wsNode, double& x, double& y)
+	{
+		if (doc.type(wsNode) != Sqf::Document::TYPE_ARRAY || doc.size(wsNode) != 2)
+			return false;
+
+		size_t posNode = doc.child(wsNode,1);
+		if (doc.type(posNode) != Sqf::Document::TYPE_ARRAY || doc.size(posNode) < 2)
+			return false;
+
+		try
+		{
+			x = doc.getDouble(doc.child(posNode,0));
+			y = doc.getDouble(doc.child(posNode,1));
+		}
+		catch (const boost::bad_get&)
+		{
+			return false;
+		}
+		return InWorld(x) && InWorld(y);
+	}
+
+	Sqf::RawValue RawNode(const Sqf::Document& doc, size_t node)
+	{
+		string text;
+		doc.write(node,text);
+		return Sqf::RawValue(std::move(text));
+	}
+
+	const size_t NUM_ROW_FIELDS = 9;
+};
+
+ObjectStore::ObjectStore( double cellSize ) : _cellSize(cellSize), _lastHandle(0)
+{
+	if (!(_cellSize > 0) || !InWorld(_cellSize))
+		_cellSize = 100;
+	//keeps the cell numbers of the whole world within 32 bits
+	else if (_cellSize < 1)
+		_cellSize = 1;
+}
+
+void ObjectStore::clear()
+{
+	_objects.clear();
+	_byId.clear();
+	_byUID.clear();
+	_byOwner.clear();
+	_grid.clear();
+}
+
+bool ObjectStore::addStreamed( const char* text, size_t len, Int64 uniqueId )
+{
+	Sqf::Document doc;
+	if (!doc.parseValue(text,len))
+		return false;
+
+	const size_t root = doc.root();
+	if (doc.type(root) != Sqf::Document::TYPE_ARRAY || doc.size(root) < NUM_ROW_FIELDS)
+		return false;
+
+	Object obj;
+	try
+	{
+		if (doc.getStringAny(doc.child(root,0)) != "OBJ")
+			return false;
+
+		obj.objectId = lexical_cast<Int64>(doc.getStringAny(doc.child(root,1)));
+		obj.className = doc.getStringAny(doc.child(root,2));
+		obj.characterId = lexical_cast<int>(doc.getStringAny(doc.child(root,3)));
+		obj.worldspace = RawNode(doc,doc.child(root,4));
+		obj.inventory = RawNode(doc,doc.child(root,5));
+		obj.hitpoints = RawNode(doc,doc.child(root,6));
+		obj.fuel = doc.getDouble(doc.child(root,7));
+		obj.damage = doc.getDouble(doc.child(root,8));
+	}
+	catch (const boost::bad_lexical_cast&)
+	{
+		return false;
+	}
+	catch (const boost::bad_get&)
+	{
+		return false;
+	}
+
+	obj.hasPos = ReadPosition(doc,doc.child(root,4),obj.x,obj.y);
+	obj.uniqueId = uniqueId;
+	//an object published this session keeps the ObjectUID it was published with
+	Handle existing = find(obj.objectId,false);
+	if (existing != 0)
+	{
+		if (obj.uniqueId == 0)
+			obj.uniqueId = _objects[existing].uniqueId;
+		remove(obj.objectId,false);
+	}
+	//one published without its ObjectID is the same object, now that the ID is known
+	if (obj.uniqueId != 0)
+	{
+		auto uidIt = _objects.find(find(obj.uniqueId,true));
+		if (uidIt != _objects.end() && uidIt->second.objectId == 0)
+			remove(obj.uniqueId,true);
+	}
+
+	insert(std::move(obj));
+	return true;
+}
+
+void ObjectStore::addPublished( Int64 objectId, Int64 uniqueId, const string& className, int characterId, 
+	const string& worldspace, const string& inventory, const string& hitpoints, double fuel, double damage )
+{
+	//publishing again under the same ids replaces the old one
+	if (objectId != 0)
+		remove(objectId,false);
+	if (uniqueId != 0)
+		remove(uniqueId,true);
+
+	Object obj;
+	obj.objectId = objectId;
+	obj.uniqueId = uniqueId;
+	obj.className = className;
+	obj.characterId = characterId;
+	obj.worldspace = Sqf::RawValue(worldspace);
+	obj.inventory = Sqf::RawValue(inventory);
+	obj.hitpoints = Sqf::RawValue(hitpoints);
+	obj.fuel = fuel;
+	obj.damage = damage;
+
+	Sqf::Document doc;
+	obj.hasPos = doc.parseValue(worldspace.c_str(),worldspace.length()) && ReadPosition(doc,doc.root(),obj.x,obj.y);
+	insert(std::move(obj));
+}
+
+ObjectStore::Handle ObjectStore::insert( Object obj )
+{
+	Handle handle = ++_lastHandle;
+	Object& stored = _objects[handle];
+	stored = std::move(obj);
+
+	if (stored.objectId != 0)
+		_byId[stored.objectId] = handle;
+	if (stored.uniqueId != 0)
+		_byUID[stored.uniqueId] = handle;
+	_byOwner[stored.characterId].insert(handle);
+	if (stored.hasPos)
+		_grid[cellOf(stored.x,stored.y)].insert(handle);
+
+	return handle;
+}
+
+ObjectStore::Handle ObjectStore::find( Int64 objectIdent, bool byUID ) const
+{
+	const unordered_map<Int64,Handle>& index = byUID ? _byUID : _byId;
+	auto it = index.find(objectIdent);
+	if (it == index.end())
+		return 0;
+
+	return it->second;
+}
+
+void ObjectStore::remove( Int64 objectIdent, bool byUID )
+{
+	Handle handle = find(objectIdent,byUID);
+	auto it = _objects.find(handle);
+	if (it == _objects.end())
+		return;
+
+	Object& obj = it->second;
+	unplace(handle,obj);
+	if (obj.objectId != 0)
+		_byId.erase(obj.objectId);
+	if (obj.uniqueId != 0)
+		_byUID.erase(obj.uniqueId);
+
+	auto ownerIt = _byOwner.find(obj.characterId);
+	if (ownerIt != _byOwner.end())
+	{
+		ownerIt->second.erase(handle);
+		if (ownerIt->second.empty())
+			_byOwner.erase(ownerIt);
+	}
+
+	_objects.erase(it);
+}
+
+void ObjectStore::setInventory( Int64 objectIdent, bool byUID, const string& inventory )
+{
+	auto it = _objects.find(find(objectIdent,byUID));
+	if (it != _objects.end())
+		it->second.inventory = Sqf::RawValue(inventory);
+}
+
+void ObjectStore::setMovement( Int64 objectId, const string& worldspace, double fuel )
+{
+	Handle handle = find(objectId,false);
+	auto it = _objects.find(handle);
+	if (it == _objects.end())
+		return;
+
+	Object& obj = it->second;
+	obj.worldspace = Sqf::RawValue(worldspace);
+	obj.fuel = fuel;
+	place(handle,obj);
+}
+
+void ObjectStore::setStatus( Int64 objectId, const string& hitpoints, double damage )
+{
+	auto it = _objects.find(find(objectId,false));
+	if (it == _objects.end())
+		return;
+
+	it->second.hitpoints = Sqf::RawValue(hitpoints);
+	it->second.damage = damage;
+}
+
+void ObjectStore::place( Handle handle, Object& obj )
+{
+	unplace(handle,obj);
+
+	const string& wsText = obj.worldspace.text();
+	Sqf::Document doc;
+	obj.hasPos = doc.parseValue(wsText.c_str(),wsText.length()) && ReadPosition(doc,doc.root(),obj.x,obj.y);
+	if (obj.hasPos)
+		_grid[cellOf(obj.x,obj.y)].insert(handle);
+}
+
+void ObjectStore::unplace( Handle handle, Object& obj )
+{
+	if (!obj.hasPos)
+		return;
+
+	auto cellIt = _grid.find(cellOf(obj.x,obj.y));
+	if (cellIt != _grid.end())
+	{
+		cellIt->second.erase(handle);
+		if (cellIt->second.empty())
+			_grid.erase(cellIt);
+	}
+	obj.hasPos = false;
+}
+
+ObjectStore::CellKey ObjectStore::makeCell( Int64 cellX, Int64 cellY ) const
+{
+	return static_cast<CellKey>((static_cast<UInt64>(cellX) << 32) | static_cast<UInt32>(cellY));
+}
+
+ObjectStore::CellKey ObjectStore::cellOf( double x, double y ) const
+{
+	return makeCell(static_cast<Int64>(std::floor(x/_cellSize)),static_cast<Int64>(std::floor(y/_cellSize)));
+}
+
+Sqf::Value ObjectStore::toRow( const Object& obj ) const
+{
+	Sqf::Parameters row;
+	row.push_back(lexical_cast<string>(obj.objectId));
+	row.push_back(lexical_cast<string>(obj.uniqueId));
+	row.push_back(obj.className);
+	row.push_back(lexical_cast<string>(obj.characterId));
+	row.push_back(obj.worldspace);
+	row.push_back(obj.inventory);
+	row.push_back(obj.hitpoints);
+	row.push_back(obj.fuel);
+	row.push_back(obj.damage);
+	return row;
+}
+
+Sqf::Parameters ObjectStore::findInRadius( double x, double y, double radius ) const
+{
+	Sqf::Parameters found;
+	if (!InWorld(x) || !InWorld(y) || !(radius >= 0))
+		return found;
+
+	//stored positions are all in the world, so the cells past it never need looking at
+	radius = std::min(radius,4*WORLD_EXTENT);
+	const double radiusSq = radius*radius;
+	const Int64 minX = static_cast<Int64>(std::floor(std::max(x-radius,-WORLD_EXTENT)/_cellSize));
+	const Int64 maxX = static_cast<Int64>(std::floor(std::min(x+radius,WORLD_EXTENT)/_cellSize));
+	const Int64 minY = static_cast<Int64>(std::floor(std::max(y-radius,-WORLD_EXTENT)/_cellSize));
+	const Int64 maxY = static_cast<Int64>(std::floor(std::min(y+radius,WORLD_EXTENT)/_cellSize));
+
+	//a radius that covers more cells than there are in use is quicker to answer by going through those
+	const double numCells = double(maxX-minX+1)*double(maxY-minY+1);
+	if (numCells > _grid.size())
+	{
+		for (auto cellIt=_grid.begin(); cellIt!=_grid.end(); ++cellIt)
+		{
+			for (auto it=cellIt->second.begin(); it!=cellIt->second.end(); ++it)
+			{
+				const Object& obj = _objects.find(*it)->second;
+				const double dx = obj.x-x, dy = obj.y-y;
+				if (dx*dx+dy*dy <= radiusSq)
+					found.push_back(toRow(obj));
+			}
+		}
+		return found;
+	}
+
+	for (Int64 cellX=minX; cellX<=maxX; cellX++)
+	{
+		for (Int64 cellY=minY; cellY<=maxY; cellY++)
+		{
+			auto cellIt = _grid.find(makeCell(cellX,cellY));
+			if (cellIt == _grid.end())
+				continue;
+
+			for (auto it=cellIt->second.begin(); it!=cellIt->second.end(); ++it)
+			{
+				const Object& obj = _objects.find(*it)->second;
+				const double dx = obj.x-x, dy = obj.y-y;
+				if (dx*dx+dy*dy <= radiusSq)
+					found.push_back(toRow(obj));
+			}
+		}
+	}
+	return found;
+}
+
+Sqf::Parameters ObjectStore::findByOwner( int characterId ) const
+{
+	Sqf::Parameters found;
+	auto ownerIt = _byOwner.find(characterId);
+	if (ownerIt == _byOwner.end())
+		return found;
+
+	for (auto it=ownerIt->second.begin(); it!=ownerIt->second.end(); ++it)
+		found.push_back(toRow(_objects.find(*it)->second));
+
+	return found;
+}
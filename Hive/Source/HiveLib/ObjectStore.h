@@ -0,0 +1,92 @@
+/*
+* Copyright (C) 2009-2013 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "Sqf.h"
+
+#include <boost/unordered_set.hpp>
+
+//what the server's objects currently look like, so they can be looked up without asking the database
+//it starts out with the objects that get streamed, and follows the object methods from there
+//rows are returned as [ObjectID,ObjectUID,Classname,CharacterID,Worldspace,Inventory,Hitpoints,Fuel,Damage]
+//with the ids stringified, ObjectID is "0" for objects that only have an ObjectUID so far and the other way around
+class ObjectStore
+{
+public:
+	//positions are indexed on a grid of cellSize by cellSize squares
+	explicit ObjectStore(double cellSize);
+
+	void clear();
+	size_t size() const { return _objects.size(); }
+
+	//a ["OBJ",...] row as it gets streamed, false if it isn't one, replaces the object if it's already there
+	//with uniqueId given, an object that was only known by that ObjectUID so far is replaced as well
+	bool addStreamed(const char* text, size_t len, Int64 uniqueId = 0);
+	//objectId is 0 if it won't be known until the object is loaded again
+	void addPublished(Int64 objectId, Int64 uniqueId, const string& className, int characterId, 
+		const string& worldspace, const string& inventory, const string& hitpoints, double fuel, double damage);
+	void remove(Int64 objectIdent, bool byUID);
+	void setInventory(Int64 objectIdent, bool byUID, const string& inventory);
+	void setMovement(Int64 objectId, const string& worldspace, double fuel);
+	void setStatus(Int64 objectId, const string& hitpoints, double damage);
+
+	//objects whose position is within radius of [x,y], objects without a position are never in there
+	Sqf::Parameters findInRadius(double x, double y, double radius) const;
+	Sqf::Parameters findByOwner(int characterId) const;
+private:
+	typedef UInt32 Handle;
+	typedef Int64 CellKey;
+	struct Object
+	{
+		Object() : objectId(0), uniqueId(0), characterId(0), fuel(0), damage(0), hasPos(false), x(0), y(0),
+			worldspace(string("[]")), inventory(string("[]")), hitpoints(string("[]")) {}
+
+		Int64 objectId;
+		Int64 uniqueId;
+		string className;
+		int characterId;
+		double fuel;
+		double damage;
+		bool hasPos;
+		double x, y;
+		//kept as they came in, they're only passed along
+		Sqf::RawValue worldspace;
+		Sqf::RawValue inventory;
+		Sqf::RawValue hitpoints;
+	};
+
+	Handle insert(Object obj);
+	//0 if there's no such object
+	Handle find(Int64 objectIdent, bool byUID) const;
+	//moves the object on the grid to wherever its worldspace says it is
+	void place(Handle handle, Object& obj);
+	void unplace(Handle handle, Object& obj);
+	CellKey cellOf(double x, double y) const;
+	CellKey makeCell(Int64 cellX, Int64 cellY) const;
+	Sqf::Value toRow(const Object& obj) const;
+
+	double _cellSize;
+	Handle _lastHandle;
+	typedef boost::unordered_set<Handle> HandleSet;
+	unordered_map<Handle,Object> _objects;
+	unordered_map<Int64,Handle> _byId;
+	unordered_map<Int64,Handle> _byUID;
+	unordered_map<int,HandleSet> _byOwner;
+	unordered_map<CellKey,HandleSet> _grid;
+};
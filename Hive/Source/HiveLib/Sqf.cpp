@@ -17,6 +17,11 @@
 */
 
 #include "Sqf.h"
+#include "SqfArgs.h"
+#include "ObjectStore.h"
+#include "DataSource/WriteFilter.h"
+
+#include <Poco/Logger.h>
 
 #include <boost/spirit/include/qi.hpp>
 namespace qi=boost::spirit::qi;
@@ -104,12 +109,670 @@ namespace std
 	}
 };
 
+#include <cstdlib>
+#include <iterator>
+#include <limits>
+#include <boost/lexical_cast.hpp>
+
+namespace
+{
+	//scanner output targets, each receives parsed items in document order
+	//mark/rollback let the scanner discard output of alternatives that didn't match
+
+	//appends finished values to a vector, arrays collect their elements from its tail
+	class ValueBuilder
+	{
+	public:
+		ValueBuilder(vector<Sqf::Value>& values) : _values(values) {}
+
+		size_t mark() const { return _values.size(); }
+		void rollback(size_t m) { _values.resize(m); }
+
+		void addDouble(double val) { _values.push_back(val); }
+		void addInt(int val) { _values.push_back(val); }
+		void addBigInt(Int64 val) { _values.push_back(val); }
+		void addBool(bool val) { _values.push_back(val); }
+		void addString(const char* begin, const char* end) { _values.push_back(string(begin,end)); }
+		void addAny() { _values.push_back(static_cast<void*>(nullptr)); }
+
+		size_t beginArray() { return _values.size(); }
+		void endArray(size_t m)
+		{
+			vector<Sqf::Value> elems(std::make_move_iterator(_values.begin()+m),std::make_move_iterator(_values.end()));
+			_values.resize(m);
+			_values.push_back(std::move(elems));
+		}
+	private:
+		vector<Sqf::Value>& _values;
+	};
+
+	//builds nothing, for checking structure only
+	class NullBuilder
+	{
+	public:
+		size_t mark() const { return 0; }
+		void rollback(size_t m) {}
+
+		void addDouble(double val) {}
+		void addInt(int val) {}
+		void addBigInt(Int64 val) {}
+		void addBool(bool val) {}
+		void addString(const char* begin, const char* end) {}
+		void addAny() {}
+
+		size_t beginArray() { return 0; }
+		void endArray(size_t m) {}
+	};
+
+	//appends nodes to a Sqf::Document tape
+	class TapeBuilder
+	{
+	public:
+		typedef Sqf::Document::Node Node;
+		TapeBuilder(vector<Node>& nodes) : _nodes(nodes) {}
+
+		size_t mark() const { return _nodes.size(); }
+		void rollback(size_t m) { _nodes.resize(m); }
+
+		void addDouble(double val) { add(Sqf::Document::TYPE_DOUBLE).dblVal = val; }
+		void addInt(int val) { add(Sqf::Document::TYPE_INT).intVal = val; }
+		void addBigInt(Int64 val) { add(Sqf::Document::TYPE_BIGINT).intVal = val; }
+		void addBool(bool val) { add(Sqf::Document::TYPE_BOOL).intVal = val ? 1 : 0; }
+		void addString(const char* begin, const char* end)
+		{
+			Node& node = add(Sqf::Document::TYPE_STRING);
+			node.strVal = begin;
+			node.len = end-begin;
+		}
+		void addAny() { add(Sqf::Document::TYPE_ANY); }
+
+		size_t beginArray()
+		{
+			add(Sqf::Document::TYPE_ARRAY);
+			return _nodes.size()-1;
+		}
+		void endArray(size_t m)
+		{
+			Node& arr = _nodes[m];
+			arr.end = _nodes.size();
+			for (size_t i=m+1;i<arr.end;i=_nodes[i].end)
+				arr.len++;
+		}
+	private:
+		Node& add(Sqf::Document::NodeType type)
+		{
+			Node node;
+			node.type = type;
+			node.len = 0;
+			node.end = _nodes.size()+1;
+			node.intVal = 0;
+			_nodes.push_back(node);
+			return _nodes.back();
+		}
+
+		vector<Node>& _nodes;
+	};
+
+	//hand-written equivalent of SqfValueParser/SqfParametersParser above
+	//works directly on the character buffer so it needs no stream or multi_pass iterator
+	//every rule mirrors its grammar counterpart, including backtracking behaviour
+	template<typename Builder>
+	class SqfScanner
+	{
+	public:
+		SqfScanner(const char* str, size_t len, Builder& builder) : _pos(str), _end(str+len), _builder(builder) {}
+
+		bool parseValue()
+		{
+			if (!value())
+				return false;
+
+			skipSpace();
+			return (_pos == _end);
+		}
+
+		//text after the last colon isn't a parameter and is ignored, like the Spirit grammar does
+		void parseParameters()
+		{
+			for (;;)
+			{
+				const char* save = _pos;
+				const size_t m = _builder.mark();
+				if (!value() || !peekLit(':'))
+				{
+					//bare word fallback, everything up to the next colon (leading whitespace skipped)
+					_builder.rollback(m);
+					_pos = save;
+					skipSpace();
+					const char* wordStart = _pos;
+					while (_pos != _end && *_pos != ':')
+						++_pos;
+
+					if (_pos == _end)
+					{
+						_pos = save;
+						return;
+					}
+					_builder.addString(wordStart,_pos);
+				}
+				++_pos; //the colon itself
+			}
+		}
+	private:
+		static bool isSpace(char c) { return (c == ' ' || (c >= '\t' && c <= '\r')); }
+		static bool isDigit(char c) { return (c >= '0' && c <= '9'); }
+		static char toLower(char c) { return (c >= 'A' && c <= 'Z') ? (c - 'A' + 'a') : c; }
+
+		void skipSpace()
+		{
+			while (_pos != _end && isSpace(*_pos))
+				++_pos;
+		}
+		//skips whitespace then checks the next character without consuming it
+		bool peekLit(char c)
+		{
+			skipSpace();
+			return (_pos != _end && *_pos == c);
+		}
+		bool consumeLit(const char* lit)
+		{
+			const char* p = _pos;
+			for (;*lit;++lit,++p)
+			{
+				if (p == _end || *p != *lit)
+					return false;
+			}
+			_pos = p;
+			return true;
+		}
+		bool consumeNoCase(const char*& p, const char* lit) const
+		{
+			const char* q = p;
+			for (;*lit;++lit,++q)
+			{
+				if (q == _end || toLower(*q) != *lit)
+					return false;
+			}
+			p = q;
+			return true;
+		}
+
+		bool value()
+		{
+			skipSpace();
+			if (_pos == _end)
+				return false;
+
+			if (number())
+				return true;
+			if (consumeLit("true"))
+			{
+				_builder.addBool(true);
+				return true;
+			}
+			if (consumeLit("false"))
+			{
+				_builder.addBool(false);
+				return true;
+			}
+			if (*_pos == '"' || *_pos == '\'')
+				return quotedString();
+			if (consumeLit("any"))
+			{
+				_builder.addAny();
+				return true;
+			}
+			if (*_pos == '[')
+				return array();
+
+			return false;
+		}
+
+		bool quotedString()
+		{
+			const char quote = *_pos;
+			const char* p = _pos+1;
+			while (p != _end && *p != quote)
+			{
+				//ascii::char_ only accepts 7bit characters
+				if (static_cast<unsigned char>(*p) > 0x7F)
+					return false;
+				++p;
+			}
+			if (p == _end)
+				return false;
+
+			_builder.addString(_pos+1,p);
+			_pos = p+1;
+			return true;
+		}
+
+		bool array()
+		{
+			const char* save = _pos;
+			++_pos; //opening bracket
+
+			const size_t arr = _builder.beginArray();
+			if (value())
+			{
+				for (;;)
+				{
+					const char* beforeSep = _pos;
+					if (!peekLit(','))
+						break;
+					++_pos;
+					if (!value())
+					{
+						_pos = beforeSep;
+						break;
+					}
+				}
+			}
+
+			if (!peekLit(']'))
+			{
+				_builder.rollback(arr);
+				_pos = save;
+				return false;
+			}
+			++_pos;
+			_builder.endArray(arr);
+			return true;
+		}
+
+		//strict_double | (int_ >> !digit) | long_long
+		bool number()
+		{
+			double dblVal;
+			if (strictDouble(dblVal))
+			{
+				_builder.addDouble(dblVal);
+				return true;
+			}
+
+			Int64 bigVal;
+			const char* p = _pos;
+			if (!integer(p,bigVal))
+				return false;
+
+			if (bigVal >= std::numeric_limits<int>::min() && bigVal <= std::numeric_limits<int>::max())
+			{
+				const char* after = p;
+				while (after != _end && isSpace(*after))
+					++after;
+				if (after == _end || !isDigit(*after))
+				{
+					_builder.addInt(static_cast<int>(bigVal));
+					_pos = p;
+					return true;
+				}
+			}
+			_builder.addBigInt(bigVal);
+			_pos = p;
+			return true;
+		}
+
+		//optional sign followed by digits, fails on 64bit overflow
+		bool integer(const char*& p, Int64& out) const
+		{
+			const char* q = p;
+			bool negative = false;
+			if (q != _end && (*q == '+' || *q == '-'))
+				negative = (*q++ == '-');
+			if (q == _end || !isDigit(*q))
+				return false;
+
+			const UInt64 limit = negative ? (static_cast<UInt64>(std::numeric_limits<Int64>::max())+1) : static_cast<UInt64>(std::numeric_limits<Int64>::max());
+			UInt64 accum = 0;
+			for (;q != _end && isDigit(*q);++q)
+			{
+				const unsigned digit = *q - '0';
+				if (accum > (limit - digit) / 10)
+					return false;
+				accum = accum*10 + digit;
+			}
+			out = negative ? static_cast<Int64>(0-accum) : static_cast<Int64>(accum);
+			p = q;
+			return true;
+		}
+
+		//same acceptance rules as qi::real_parser with strict_real_policies:
+		//a number without a decimal point or exponent is not a double
+		bool strictDouble(double& out)
+		{
+			const char* p = _pos;
+			bool negative = false;
+			if (p != _end && (*p == '+' || *p == '-'))
+				negative = (*p++ == '-');
+
+			const char* intStart = p;
+			while (p != _end && isDigit(*p))
+				++p;
+			const char* intEnd = p;
+
+			if (intStart == intEnd)
+			{
+				const char* special = p;
+				if (consumeNoCase(special,"nan"))
+				{
+					if (special != _end && *special == '(')
+					{
+						while (++special != _end && *special != ')');
+						if (special == _end)
+							return false;
+						++special;
+					}
+					out = std::numeric_limits<double>::quiet_NaN();
+					if (negative)
+						out = -out;
+					_pos = special;
+					return true;
+				}
+				if (consumeNoCase(special,"inf"))
+				{
+					consumeNoCase(special,"inity");
+					out = std::numeric_limits<double>::infinity();
+					if (negative)
+						out = -out;
+					_pos = special;
+					return true;
+				}
+			}
+
+			const char* fracStart = p;
+			const char* fracEnd = p;
+			bool hasDot = false;
+			if (p != _end && *p == '.')
+			{
+				hasDot = true;
+				fracStart = fracEnd = ++p;
+				while (fracEnd != _end && isDigit(*fracEnd))
+					++fracEnd;
+				if (intStart == intEnd && fracStart == fracEnd)
+					return false;
+				p = fracEnd;
+			}
+			else if (intStart == intEnd)
+				return false;
+
+			int exponent = 0;
+			if (p != _end && (*p == 'e' || *p == 'E'))
+			{
+				const char* expStr = p+1;
+				Int64 bigExp;
+				if (!integer(expStr,bigExp) || bigExp < std::numeric_limits<int>::min() || bigExp > std::numeric_limits<int>::max())
+					return false;
+				exponent = static_cast<int>(bigExp);
+				p = expStr;
+			}
+			else if (!hasDot)
+				return false;
+
+			//qi::real_parser gives up on a power of ten past what a double has, the other rules get a go at it
+			if (static_cast<Int64>(exponent) - (fracEnd - fracStart) > std::numeric_limits<double>::max_exponent10)
+				return false;
+
+			out = toDouble(_pos,p,intStart,intEnd,fracStart,fracEnd,exponent);
+			if (negative)
+				out = -out;
+			_pos = p;
+			return true;
+		}
+
+		//exact when the mantissa and power of ten are both exactly representable, strtod otherwise
+		static double toDouble(const char* numStart, const char* numEnd,
+			const char* intStart, const char* intEnd, const char* fracStart, const char* fracEnd, int exponent)
+		{
+			static const double exactPowers[] = 
+			{
+				1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+				1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+			};
+			const int maxExactPower = 22;
+			const int maxExactDigits = 15;
+
+			UInt64 mantissa = 0;
+			int numDigits = 0;
+			bool tooLong = false;
+			for (const char* c=intStart;c!=intEnd;++c)
+			{
+				if (mantissa == 0 && *c == '0')
+					continue;
+				if (++numDigits > maxExactDigits) { tooLong = true; break; }
+				mantissa = mantissa*10 + (*c - '0');
+			}
+			for (const char* c=fracStart;c!=fracEnd && !tooLong;++c)
+			{
+				if (mantissa != 0 || *c != '0')
+				{
+					if (++numDigits > maxExactDigits) { tooLong = true; break; }
+				}
+				mantissa = mantissa*10 + (*c - '0');
+			}
+
+			if (!tooLong)
+			{
+				const Int64 scale = static_cast<Int64>(exponent) - (fracEnd - fracStart);
+				if (mantissa == 0)
+					return 0.0;
+				if (scale >= 0 && scale <= maxExactPower)
+					return static_cast<double>(mantissa) * exactPowers[scale];
+				if (scale < 0 && scale >= -maxExactPower)
+					return static_cast<double>(mantissa) / exactPowers[-scale];
+			}
+
+			//sign is applied by the caller
+			while (numStart != numEnd && (*numStart == '+' || *numStart == '-'))
+				++numStart;
+			string numStr(numStart,numEnd);
+			return strtod(numStr.c_str(),nullptr);
+		}
+
+		const char* _pos;
+		const char* _end;
+		Builder& _builder;
+	};
+};
+
+namespace Sqf
+{
+	bool ParseValue(const char* str, size_t len, Value& out)
+	{
+		vector<Value> result;
+		ValueBuilder builder(result);
+		if (!SqfScanner<ValueBuilder>(str,len,builder).parseValue())
+			return false;
+
+		out = std::move(result.front());
+		return true;
+	}
+
+	void ParseParameters(const char* str, size_t len, Parameters& out)
+	{
+		ValueBuilder builder(out);
+		SqfScanner<ValueBuilder>(str,len,builder).parseParameters();
+	}
+
+	Value MakeRaw(string text)
+	{
+		NullBuilder builder;
+		if (SqfScanner<NullBuilder>(text.c_str(),text.length(),builder).parseValue())
+			return RawValue(std::move(text));
+
+		return boost::lexical_cast<Value>(text);
+	}
+
+	void Document::parseParameters(const char* str, size_t len)
+	{
+		_nodes.clear();
+		TapeBuilder builder(_nodes);
+		const size_t root = builder.beginArray();
+		SqfScanner<TapeBuilder>(str,len,builder).parseParameters();
+		builder.endArray(root);
+	}
+
+	bool Document::parseValue(const char* str, size_t len)
+	{
+		_nodes.clear();
+		TapeBuilder builder(_nodes);
+		if (!SqfScanner<TapeBuilder>(str,len,builder).parseValue())
+		{
+			_nodes.clear();
+			return false;
+		}
+		return true;
+	}
+};
+
 
 #include <boost/spirit/include/karma.hpp>
+#include <boost/spirit/include/phoenix_bind.hpp>
+#include <boost/spirit/include/phoenix_operator.hpp>
 namespace karma=boost::spirit::karma;
+namespace phoenix=boost::phoenix;
+
+#include <cstring>
+#include <cstdio>
+#include <cmath>
 
 namespace
 {
+	Sqf::NumberFormat gNumberFormat = Sqf::NUMBERS_COMPATIBLE;
+
+	const int MAX_DECIMAL_SCALE = 15;
+	const double DecimalPowers[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15
+	};
+	//largest magnitude where every integer is representable
+	const double MAX_EXACT_INTEGER = 9007199254740992.0;
+
+	bool IsFinite(double val) { return (val == val) && (val-val == 0); }
+
+	size_t WriteUnsigned(UInt64 val, char* out)
+	{
+		char digits[24];
+		size_t numDigits = 0;
+		do 
+		{
+			digits[numDigits++] = static_cast<char>('0' + val%10);
+			val /= 10;
+		} 
+		while (val > 0);
+
+		for (size_t i=0; i<numDigits; i++)
+			out[i] = digits[numDigits-1-i];
+
+		return numDigits;
+	}
+
+	//the same steps karma's real generator takes for fixed notation with precision 3 and no trailing zeros
+	size_t FormatFixed3(double val, char* out)
+	{
+		const double precExp = 1000.0;
+		bool negative = (val < 0) || (val == 0 && 1.0/val < 0);
+		const double n = negative ? -val : val;
+
+		double integerPart;
+		double fractionalPart = std::floor(std::modf(n,&integerPart)*precExp + 0.5);
+		if (fractionalPart >= precExp)
+		{
+			fractionalPart = std::floor(fractionalPart - precExp);
+			integerPart += 1;
+		}
+
+		UInt64 intDigits = static_cast<UInt64>(std::floor(integerPart));
+		UInt64 fracDigits = static_cast<UInt64>(fractionalPart);
+		int prec = 3;
+		if (fracDigits != 0)
+		{
+			while (prec != 0 && fracDigits%10 == 0)
+			{
+				fracDigits /= 10;
+				prec--;
+			}
+		}
+		else
+			prec = 0;
+
+		if (intDigits == 0 && fracDigits == 0)
+			negative = false; //no sign for zero
+
+		char* p = out;
+		if (negative)
+			*p++ = '-';
+		p += WriteUnsigned(intDigits,p);
+		*p++ = '.';
+		if (prec == 0)
+			*p++ = '0';
+		else
+		{
+			char digits[4];
+			const size_t numDigits = WriteUnsigned(fracDigits,digits);
+			for (size_t i=numDigits; i<static_cast<size_t>(prec); i++)
+				*p++ = '0';
+			memcpy(p,digits,numDigits);
+			p += numDigits;
+		}
+		return p-out;
+	}
+
+	size_t FormatKarma(double val, char* out)
+	{
+		char* outEnd = out;
+		karma::generate(outEnd,karma::double_,val);
+		return outEnd-out;
+	}
+
+	size_t FormatShortest(double val, char* out)
+	{
+		Int64 mantissa;
+		int scale;
+		if (Sqf::SplitDecimal(val,mantissa,scale))
+		{
+			char* p = out;
+			if (mantissa < 0 || (mantissa == 0 && 1.0/val < 0))
+				*p++ = '-';
+
+			char digits[24];
+			size_t numDigits = WriteUnsigned(static_cast<UInt64>(mantissa < 0 ? -mantissa : mantissa),digits);
+			if (scale == 0)
+			{
+				memcpy(p,digits,numDigits);
+				return (p+numDigits)-out;
+			}
+			if (numDigits <= static_cast<size_t>(scale))
+			{
+				*p++ = '0';
+				*p++ = '.';
+				for (size_t i=numDigits; i<static_cast<size_t>(scale); i++)
+					*p++ = '0';
+				memcpy(p,digits,numDigits);
+				return (p+numDigits)-out;
+			}
+			const size_t intDigits = numDigits-scale;
+			memcpy(p,digits,intDigits);
+			p += intDigits;
+			*p++ = '.';
+			memcpy(p,digits+intDigits,scale);
+			return (p+scale)-out;
+		}
+		//huge, tiny or full precision values, the fewest significant digits that still read back the same
+		for (int precision=1; precision<=17; precision++)
+		{
+			const int len = sprintf(out,"%.*g",precision,val);
+			if (precision == 17 || strtod(out,nullptr) == val)
+				return static_cast<size_t>(len);
+		}
+		return 0;
+	}
+
+	string FormatDoubleText(double val)
+	{
+		char buf[Sqf::MAX_NUMBER_LEN];
+		return string(buf,Sqf::FormatDouble(val,buf));
+	}
+
 	template <typename Iterator>
 	struct SqfValueGenerator : karma::grammar<Iterator, Sqf::Value()>
 	{
@@ -120,23 +783,30 @@ namespace
 			using karma::int_;
 			using karma::long_long;
 			using karma::bool_;
-			using karma::double_;
 
 			quoted_string = verbatim['"' << karma::string << '"'];
 			quoted_string.name("quoted_string");
 
+			real_value = karma::string[karma::_1 = phoenix::bind(&FormatDoubleText,karma::_val)];
+			real_value.name("real_value");
+
+			raw_value = karma::string[karma::_1 = phoenix::bind(&Sqf::RawValue::text,karma::_val)];
+			raw_value.name("raw_value");
+
 			complex_array = lit("[") << -(start % ",") << lit("]");
 			complex_array.name("complex_array");
 
 			void_pointer = karma::omit[int_] << lit("any");
 			void_pointer.name("void_pointer");
 
-			start = double_ | long_long | int_ | bool_ | quoted_string | void_pointer | complex_array;
+			start = real_value | long_long | int_ | bool_ | quoted_string | void_pointer | complex_array | raw_value;
 		}
 
+		karma::rule<Iterator, double()> real_value;
 		karma::rule<Iterator, string()> quoted_string;
 		karma::rule<Iterator, vector<Sqf::Value>()> complex_array;
 		karma::rule<Iterator, void*()> void_pointer;
+		karma::rule<Iterator, Sqf::RawValue()> raw_value;
 		karma::rule<Iterator, Sqf::Value()> start;
 	};
 
@@ -174,11 +844,305 @@ namespace std
 	}
 };
 
+namespace
+{
+	//fixed size character sink, never writes past the end of the buffer
+	class BoundedSink
+	{
+	public:
+		BoundedSink(char* buf, size_t size) : _pos(buf), _end(buf+size) {}
+
+		bool put(char c)
+		{
+			if (_pos == _end)
+				return false;
+			*_pos++ = c;
+			return true;
+		}
+		bool write(const char* str, size_t len)
+		{
+			if (static_cast<size_t>(_end-_pos) < len)
+				return false;
+			memcpy(_pos,str,len);
+			_pos += len;
+			return true;
+		}
+		char* pos() const { return _pos; }
+	private:
+		char* _pos;
+		char* _end;
+	};
+
+	//growing sink, never fails
+	class StringSink
+	{
+	public:
+		StringSink(string& out) : _out(out) {}
+
+		bool put(char c) { _out.push_back(c); return true; }
+		bool write(const char* str, size_t len) { _out.append(str,len); return true; }
+	private:
+		string& _out;
+	};
+
+	//integers are formatted with the very same karma generators SqfValueGenerator uses
+	template<typename Sink, typename Generator, typename T>
+	bool WriteScalar(Sink& sink, const Generator& gen, T val)
+	{
+		char buf[64];
+		char* bufEnd = buf;
+		if (!karma::generate(bufEnd,gen,val))
+			return false;
+		return sink.write(buf,bufEnd-buf);
+	}
+
+	template<typename Sink>
+	bool WriteDouble(Sink& sink, double val)
+	{
+		char buf[Sqf::MAX_NUMBER_LEN];
+		return sink.write(buf,Sqf::FormatDouble(val,buf));
+	}
+
+	template<typename Sink>
+	bool WriteString(Sink& sink, const char* str, size_t len, bool quoted)
+	{
+		if (!quoted)
+			return sink.write(str,len);
+
+		return sink.put('"') && sink.write(str,len) && sink.put('"');
+	}
+
+	//walks the value the same way SqfValueGenerator does, but streams into a sink
+	//this avoids the grammar's alternative buffering so overflow is caught as it happens
+	template<typename Sink>
+	class SinkWriteVisitor : public boost::static_visitor<bool>
+	{
+	public:
+		SinkWriteVisitor(Sink& sink) : _sink(sink) {}
+
+		bool operator()(double val) const { return WriteDouble(_sink,val); }
+		bool operator()(int val) const { return WriteScalar(_sink,karma::int_,val); }
+		bool operator()(Int64 val) const { return WriteScalar(_sink,karma::long_long,val); }
+		bool operator()(bool val) const { return val ? _sink.write("true",4) : _sink.write("false",5); }
+		bool operator()(const string& val) const { return WriteString(_sink,val.c_str(),val.length(),true); }
+		bool operator()(void* val) const { return _sink.write("any",3); }
+		bool operator()(const Sqf::RawValue& raw) const { return _sink.write(raw.text().c_str(),raw.text().length()); }
+		bool operator()(const Sqf::Parameters& arr) const
+		{
+			if (!_sink.put('['))
+				return false;
+			for (auto it=arr.begin();it!=arr.end();++it)
+			{
+				if (it != arr.begin() && !_sink.put(','))
+					return false;
+				if (!boost::apply_visitor(*this,*it))
+					return false;
+			}
+			return _sink.put(']');
+		}
+	private:
+		Sink& _sink;
+	};
+
+	//same output as SinkWriteVisitor, but straight from a Sqf::Document tape
+	template<typename Sink>
+	bool WriteTapeNode(const vector<Sqf::Document::Node>& nodes, size_t idx, Sink& sink, bool quoteStrings)
+	{
+		const Sqf::Document::Node& node = nodes[idx];
+		switch (node.type)
+		{
+		case Sqf::Document::TYPE_DOUBLE: return WriteDouble(sink,node.dblVal);
+		case Sqf::Document::TYPE_INT: return WriteScalar(sink,karma::int_,static_cast<int>(node.intVal));
+		case Sqf::Document::TYPE_BIGINT: return WriteScalar(sink,karma::long_long,node.intVal);
+		case Sqf::Document::TYPE_BOOL: return node.intVal ? sink.write("true",4) : sink.write("false",5);
+		case Sqf::Document::TYPE_STRING: return WriteString(sink,node.strVal,node.len,quoteStrings);
+		case Sqf::Document::TYPE_ANY: return sink.write("any",3);
+		case Sqf::Document::TYPE_ARRAY:
+			{
+				if (!sink.put('['))
+					return false;
+				for (size_t child=idx+1;child!=node.end;child=nodes[child].end)
+				{
+					if (child != idx+1 && !sink.put(','))
+						return false;
+					if (!WriteTapeNode(nodes,child,sink,quoteStrings))
+						return false;
+				}
+				return sink.put(']');
+			}
+		}
+		return false;
+	}
+};
+
+namespace Sqf
+{
+	void SetNumberFormat(NumberFormat fmt) { gNumberFormat = fmt; }
+	NumberFormat GetNumberFormat() { return gNumberFormat; }
+
+	size_t FormatDouble(double val, char* out)
+	{
+		if (!IsFinite(val))
+			return FormatKarma(val,out);
+		if (gNumberFormat == NUMBERS_SHORTEST)
+			return FormatShortest(val,out);
+
+		//karma switches to scientific notation outside of this range, that's rare enough to leave to it
+		const double n = std::fabs(val);
+		if (n == 0 || (n >= 1e-3 && n < 1e5))
+			return FormatFixed3(val,out);
+
+		return FormatKarma(val,out);
+	}
+
+	bool SplitDecimal(double val, Int64& mantissa, int& scale)
+	{
+		if (!IsFinite(val))
+			return false;
+		if (val == 0)
+		{
+			mantissa = 0;
+			scale = 0;
+			return true;
+		}
+		for (int k=0; k<=MAX_DECIMAL_SCALE; k++)
+		{
+			const double scaled = val*DecimalPowers[k];
+			if (std::fabs(scaled) >= MAX_EXACT_INTEGER)
+				return false;
+
+			const Int64 rounded = static_cast<Int64>(scaled < 0 ? scaled-0.5 : scaled+0.5);
+			if (static_cast<double>(rounded)/DecimalPowers[k] == val)
+			{
+				mantissa = rounded;
+				scale = k;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	double RoundDecimals(double val, int decimals)
+	{
+		if (decimals < 0 || !IsFinite(val))
+			return val;
+		if (decimals > MAX_DECIMAL_SCALE)
+			decimals = MAX_DECIMAL_SCALE;
+
+		const double scaled = val*DecimalPowers[decimals];
+		if (std::fabs(scaled) >= MAX_EXACT_INTEGER) //no decimals left to drop
+			return val;
+
+		return std::floor(scaled + 0.5)/DecimalPowers[decimals];
+	}
+
+	void RoundNumbers(Value& val, int decimals)
+	{
+		if (decimals < 0)
+			return;
+
+		if (double* dbl = boost::get<double>(&val))
+			*dbl = RoundDecimals(*dbl,decimals);
+		else if (Parameters* arr = boost::get<Parameters>(&val))
+		{
+			for (auto it=arr->begin();it!=arr->end();++it)
+				RoundNumbers(*it,decimals);
+		}
+		else if (const RawValue* raw = boost::get<RawValue>(&val))
+		{
+			Value expanded;
+			if (ParseValue(raw->text().c_str(),raw->text().length(),expanded))
+			{
+				RoundNumbers(expanded,decimals);
+				val = expanded;
+			}
+		}
+	}
+
+	string RoundNumbers(const string& sqfText, int decimals)
+	{
+		Value val;
+		if (decimals < 0 || !ParseValue(sqfText.c_str(),sqfText.length(),val))
+			return sqfText;
+
+		RoundNumbers(val,decimals);
+		string out;
+		AppendValue(val,out);
+		return out;
+	}
+
+	void AppendValue(const Value& val, string& out)
+	{
+		StringSink sink(out);
+		boost::apply_visitor(SinkWriteVisitor<StringSink>(sink),val);
+	}
+
+	RawValue QuoteSlice(const string& text, size_t& offset, size_t budget)
+	{
+		string quoted;
+		quoted.reserve(budget+2);
+		quoted += '"';
+		while (offset < text.length())
+		{
+			char c = text[offset];
+			size_t needed = (c == '"') ? 2 : 1;
+			if (needed > budget)
+				break;
+
+			quoted += c;
+			if (c == '"')
+				quoted += c;
+
+			budget -= needed;
+			offset++;
+		}
+		quoted += '"';
+		return RawValue(std::move(quoted));
+	}
+
+	bool WriteValue(const Value& val, char* out, size_t outSize, size_t& outLen)
+	{
+		outLen = 0;
+		if (outSize < 1)
+			return false;
+
+		//leave room for the terminator
+		BoundedSink sink(out,outSize-1);
+		if (!boost::apply_visitor(SinkWriteVisitor<BoundedSink>(sink),val))
+		{
+			out[0] = 0;
+			return false;
+		}
+
+		outLen = sink.pos()-out;
+		out[outLen] = 0;
+		return true;
+	}
+
+	void Document::write(size_t node, string& out, bool quoteStrings) const
+	{
+		at(node);
+		StringSink sink(out);
+		WriteTapeNode(_nodes,node,sink,quoteStrings);
+	}
+};
+
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/trim.hpp>
 
 namespace
 {
+	//raw values are visited as whatever they contain
+	template<typename Visitor>
+	typename Visitor::result_type VisitRaw(const Visitor& visitor, const Sqf::RawValue& raw)
+	{
+		Sqf::Value expanded;
+		if (!Sqf::ParseValue(raw.text().c_str(),raw.text().length(),expanded))
+			throw boost::bad_get();
+
+		return boost::apply_visitor(visitor,expanded);
+	}
+
 	class NullVisitor : public boost::static_visitor<bool>
 	{
 	public:
@@ -189,6 +1153,7 @@ namespace
 
 			return false;
 		}
+		bool operator()(const Sqf::RawValue& raw) const { return VisitRaw(*this,raw); }
 		template<typename T> bool operator()(const T& other) const { return false; }
 	};
 
@@ -200,6 +1165,7 @@ namespace
 		{ 
 			return (ptr == nullptr); 
 		}
+		bool operator()(const Sqf::RawValue& raw) const { return VisitRaw(*this,raw); }
 		template<typename T> bool operator()(const T& other) const { return false; }
 	};
 
@@ -209,6 +1175,7 @@ namespace
 		double operator()(double decVal) const { return decVal; }
 		double operator()(float decVal) const { return static_cast<double>(decVal); }
 		double operator()(int intVal) const { return static_cast<double>(intVal); }
+		double operator()(const Sqf::RawValue& raw) const { return VisitRaw(*this,raw); }
 		template<typename T> double operator()(const T& other) const { throw boost::bad_get(); }
 	};
 
@@ -216,6 +1183,7 @@ namespace
 	{
 	public:
 		int operator()(int normalInt) const { return normalInt; }
+		int operator()(const Sqf::RawValue& raw) const { return VisitRaw(*this,raw); }
 		int operator()(const string& strInt) const
 		{
 			int parsed = -1;
@@ -259,6 +1227,7 @@ namespace
 			}
 			return parsed;
 		}
+		Int64 operator()(const Sqf::RawValue& raw) const { return VisitRaw(*this,raw); }
 		template<typename T> Int64 operator()(const T& other) const	{ throw boost::bad_get(); }
 	};
 
@@ -266,6 +1235,7 @@ namespace
 	{
 	public:
 		string operator()(const string& origStr) const { return origStr; }
+		string operator()(const Sqf::RawValue& raw) const { return VisitRaw(*this,raw); }
 		template<typename T> string operator()(const T& other) const { return lexical_cast<string>(other); }
 	};
 
@@ -296,6 +1266,7 @@ namespace
 		{
 			return (arr.size() > 0);
 		}
+		bool operator()(const Sqf::RawValue& raw) const { return VisitRaw(*this,raw); }
 		template<typename T> bool operator()(T other) const { return other != 0; }
 	};
 };
@@ -340,6 +1311,109 @@ namespace Sqf
 		return boost::apply_visitor(BooleanVisitor(),val);
 	}
 
+	const Document::Node& Document::at(size_t node) const
+	{
+		if (node >= _nodes.size())
+			throw std::out_of_range("Sqf::Document node index out of range");
+
+		return _nodes[node];
+	}
+
+	size_t Document::size(size_t node) const
+	{
+		const Node& theNode = at(node);
+		return (theNode.type == TYPE_ARRAY) ? theNode.len : 0;
+	}
+
+	size_t Document::child(size_t node, size_t idx) const
+	{
+		if (idx >= size(node))
+			throw std::out_of_range("Sqf::Document element index out of range");
+
+		size_t theChild = node+1;
+		while (idx-- > 0)
+			theChild = _nodes[theChild].end;
+
+		return theChild;
+	}
+
+	bool Document::isNull(size_t node) const
+	{
+		const Node& theNode = at(node);
+		return (theNode.type == TYPE_STRING && theNode.len < 1);
+	}
+
+	bool Document::isAny(size_t node) const
+	{
+		return (at(node).type == TYPE_ANY);
+	}
+
+	//the getters below defer to their Value counterparts for everything but arrays,
+	//scalar Values are cheap to make and this keeps the conversion rules in one place
+	double Document::getDouble(size_t node) const
+	{
+		if (at(node).type == TYPE_ARRAY)
+			throw boost::bad_get();
+
+		return GetDouble(toValue(node));
+	}
+
+	int Document::getIntAny(size_t node) const
+	{
+		if (at(node).type == TYPE_ARRAY)
+			throw boost::bad_get();
+
+		return GetIntAny(toValue(node));
+	}
+
+	Int64 Document::getBigInt(size_t node) const
+	{
+		if (at(node).type == TYPE_ARRAY)
+			throw boost::bad_get();
+
+		return GetBigInt(toValue(node));
+	}
+
+	string Document::getStringAny(size_t node) const
+	{
+		const Node& theNode = at(node);
+		if (theNode.type == TYPE_STRING)
+			return string(theNode.strVal,theNode.len);
+		
+		return GetStringAny(toValue(node));
+	}
+
+	bool Document::getBoolAny(size_t node) const
+	{
+		const Node& theNode = at(node);
+		if (theNode.type == TYPE_ARRAY)
+			return (theNode.len > 0);
+
+		return GetBoolAny(toValue(node));
+	}
+
+	Value Document::toValue(size_t node) const
+	{
+		const Node& theNode = at(node);
+		switch (theNode.type)
+		{
+		case TYPE_DOUBLE: return theNode.dblVal;
+		case TYPE_INT: return static_cast<int>(theNode.intVal);
+		case TYPE_BIGINT: return theNode.intVal;
+		case TYPE_BOOL: return (theNode.intVal != 0);
+		case TYPE_STRING: return string(theNode.strVal,theNode.len);
+		case TYPE_ANY: return static_cast<void*>(nullptr);
+		default: break;
+		}
+
+		Parameters arr;
+		arr.reserve(theNode.len);
+		for (size_t elem=first(node);elem!=next(node);elem=next(elem))
+			arr.push_back(toValue(elem));
+
+		return arr;
+	}
+
 	void runTest()
 	{
 		poco_assert(GetBoolAny(Value(true)) == true);
@@ -394,5 +1468,354 @@ namespace Sqf
 			newlyGenerated = lexical_cast<string>(parsedParameters);
 			poco_assert(newlyGenerated == *it);
 		}
+
+		//buffer parser must agree with the stream one, including its fallbacks
+		origSampleParams.push_back(generatedParams);
+		origSampleParams.push_back("CHILD:201:1337:[12,[1024.5,-33.25,0.001]]:[[\"ItemMap\",'ItemWatch'],[]]:any:true: bare word :5 6:");
+		origSampleParams.push_back("CHILD:305:99999999999:-2147483648:2147483648:1e5:.5:5.:+7:007:truex:anyx:[1,]::-:");
+		origSampleParams.push_back("CHILD:999:trailing:garbage");
+		for (auto it=origSampleParams.begin();it!=origSampleParams.end();++it)
+		{
+			Parameters fastParams;
+			ParseParameters(it->c_str(),it->length(),fastParams);
+			poco_assert(fastParams == lexical_cast<Parameters>(*it));
+			poco_assert(lexical_cast<string>(fastParams) == lexical_cast<string>(lexical_cast<Parameters>(*it)));
+		}
+		for (auto it=testSamples.begin();it!=testSamples.end();++it)
+		{
+			Value fastVal;
+			poco_assert(ParseValue(it->c_str(),it->length(),fastVal));
+			poco_assert(fastVal == lexical_cast<Value>(*it));
+		}
+		//tape document must decode to the same values and serialize identically
+		Document doc;
+		for (auto it=origSampleParams.begin();it!=origSampleParams.end();++it)
+		{
+			doc.parseParameters(it->c_str(),it->length());
+			Parameters slowParams = lexical_cast<Parameters>(*it);
+			poco_assert(doc.size(doc.root()) == slowParams.size());
+			poco_assert(doc.toValue(doc.root()) == Value(slowParams));
+			poco_assert(doc.toString(doc.root()) == lexical_cast<string>(Value(slowParams)));
+			for (size_t i=0;i<slowParams.size();i++)
+			{
+				size_t node = doc.child(doc.root(),i);
+				poco_assert(doc.getStringAny(node) == GetStringAny(slowParams[i]));
+				poco_assert(doc.getBoolAny(node) == GetBoolAny(slowParams[i]));
+				poco_assert(doc.isNull(node) == IsNull(slowParams[i]));
+				poco_assert(doc.isAny(node) == IsAny(slowParams[i]));
+				string paramStr;
+				doc.write(node,paramStr,false);
+				Parameters single(1,slowParams[i]);
+				poco_assert(paramStr+":" == lexical_cast<string>(single));
+			}
+		}
+		//text after the last colon is not a parameter, and both parsers leave it out the way the stream one does
+		{
+			vector<string> leftovers;
+			leftovers.push_back("CHILD:101:14352902: ");
+			leftovers.push_back("CHILD:101:14352902");
+			leftovers.push_back("CHILD:999:trailing:garbage");
+			leftovers.push_back("CHILD:101:[1,2");
+			for (auto it=leftovers.begin();it!=leftovers.end();++it)
+			{
+				const Parameters slowParams = lexical_cast<Parameters>(*it);
+				Parameters fastParams;
+				ParseParameters(it->c_str(),it->length(),fastParams);
+				doc.parseParameters(it->c_str(),it->length());
+				poco_assert(fastParams == slowParams && doc.toValue(doc.root()) == Value(slowParams));
+			}
+			poco_assert(doc.size(doc.root()) == 2);
+		}
+		//exponents too big for a double aren't doubles
+		{
+			vector<string> hugeSamples;
+			hugeSamples.push_back("CHILD:1e500:-1e500:1e-500:2e308:1.0e309:0.001e310:1e309:");
+			hugeSamples.push_back("[1e500]");
+			hugeSamples.push_back("1e500");
+			for (auto it=hugeSamples.begin();it!=hugeSamples.end();++it)
+			{
+				Parameters fastParams;
+				ParseParameters(it->c_str(),it->length(),fastParams);
+				poco_assert(fastParams == lexical_cast<Parameters>(*it));
+				Value fastVal;
+				bool slowOk = true;
+				try { fastVal = lexical_cast<Value>(*it); } catch (const boost::bad_lexical_cast&) { slowOk = false; }
+				Value slowVal = fastVal;
+				poco_assert(ParseValue(it->c_str(),it->length(),fastVal) == slowOk);
+				poco_assert(!slowOk || fastVal == slowVal);
+			}
+			Parameters hugeParams;
+			ParseParameters(hugeSamples[0].c_str(),hugeSamples[0].length(),hugeParams);
+			poco_assert(GetStringAny(hugeParams[1]) == "1e500" && boost::get<string>(&hugeParams[7]) != nullptr);
+		}
+		for (auto it=testSamples.begin();it!=testSamples.end();++it)
+		{
+			poco_assert(doc.parseValue(it->c_str(),it->length()));
+			poco_assert(doc.toString(doc.root()) == *it);
+		}
+		poco_assert(!doc.parseValue("[1,]",4) && doc.empty());
+
+		//direct buffer writer must produce exactly what the generator does
+		char outBuf[4096];
+		size_t outLen = 0;
+		for (auto it=params.begin();it!=params.end();++it)
+		{
+			poco_assert(WriteValue(*it,outBuf,sizeof(outBuf),outLen));
+			poco_assert(string(outBuf,outLen) == lexical_cast<string>(*it));
+		}
+		Value wholeVal = params;
+		string wholeStr = lexical_cast<string>(wholeVal);
+		poco_assert(WriteValue(wholeVal,outBuf,wholeStr.length()+1,outLen) && outLen == wholeStr.length());
+		poco_assert(!WriteValue(wholeVal,outBuf,wholeStr.length(),outLen) && outBuf[0] == 0);
+
+		//raw values are spliced in verbatim but otherwise act like what they contain
+		{
+			Value rawArr = MakeRaw("[[\"ItemMap\",'ItemWatch'], [ 5.0,any]]");
+			poco_assert(boost::get<RawValue>(&rawArr) != nullptr);
+			poco_assert(GetBoolAny(rawArr) == true);
+			poco_assert(GetBoolAny(MakeRaw("[]")) == false);
+			poco_assert(GetDouble(MakeRaw("5.5")) == 5.5);
+			poco_assert(GetStringAny(MakeRaw("\"abc\"")) == "abc");
+
+			Parameters withRaw;
+			withRaw.push_back(string("PASS"));
+			withRaw.push_back(rawArr);
+			const string expected = "[\"PASS\",[[\"ItemMap\",'ItemWatch'], [ 5.0,any]]]";
+			poco_assert(lexical_cast<string>(Value(withRaw)) == expected);
+			poco_assert(WriteValue(withRaw,outBuf,sizeof(outBuf),outLen) && string(outBuf,outLen) == expected);
+
+			//invalid text falls back to the lenient parser
+			Value lenient = MakeRaw("5 6");
+			poco_assert(boost::get<RawValue>(&lenient) == nullptr);
+			bool threw = false;
+			try { MakeRaw("[1,"); } catch (const boost::bad_lexical_cast&) { threw = true; }
+			poco_assert(threw);
+		}
+
+		Value badVal;
+		poco_assert(!ParseValue("[1,]",4,badVal));
+		poco_assert(!ParseValue("\"open",5,badVal));
+
+		//binary storage encoding must give back the same values, and decimals the way they were written
+		{
+			vector<string> binSamples(testSamples);
+			binSamples.push_back("[12,[1024.5,-33.25,0.001],-0.5,1e-07,123456789012,-2147483648]");
+			binSamples.push_back("[[\"ItemMap\",\"ItemWatch\",\"ItemMap\"],[\"\",any,true,false]]");
+			string bigInv = "[";
+			for (int i=0;i<50;i++)
+				bigInv += "[\"ItemSodaCoke\",\"FoodCanBakedBeans\"],";
+			bigInv += "[]]";
+			binSamples.push_back(bigInv);
+			for (auto it=binSamples.begin();it!=binSamples.end();++it)
+			{
+				Value orig = lexical_cast<Value>(*it);
+				for (int compress=0;compress<2;compress++)
+				{
+					ByteVector bin = EncodeBinary(orig,compress != 0);
+					const char* binData = reinterpret_cast<const char*>(&bin[0]);
+					poco_assert(IsBinary(binData,bin.size()) && !IsBinary(it->c_str(),it->length()));
+					poco_assert(DecodeBinary(binData,bin.size()) == orig);
+					poco_assert(lexical_cast<Value>(DecodeBinaryText(binData,bin.size())) == orig);
+
+					bool threw = false;
+					try { DecodeBinary(binData,bin.size()/2); } catch (const boost::bad_lexical_cast&) { threw = true; }
+					poco_assert(threw);
+				}
+			}
+			poco_assert(EncodeBinary(lexical_cast<Value>(bigInv),true).size() < EncodeBinary(lexical_cast<Value>(bigInv),false).size());
+			poco_assert(EncodeBinary(lexical_cast<Value>(bigInv),false).size() < bigInv.length());
+
+			ByteVector posBin = EncodeBinary(lexical_cast<Value>("[0.001,-1234.5678,[]]"),false);
+			poco_assert(DecodeBinaryText(reinterpret_cast<const char*>(&posBin[0]),posBin.size()) == "[0.001,-1234.5678,[]]");
+			ByteVector rawBin = EncodeBinary(MakeRaw("[\"ItemMap\",5]"),false);
+			poco_assert(DecodeBinaryText(reinterpret_cast<const char*>(&rawBin[0]),rawBin.size()) == "[\"ItemMap\",5]");
+
+			//the most negative mantissa still decodes to text
+			ByteVector minBin(posBin.begin(),posBin.begin()+4);
+			const UInt8 minBody[] = { 0, 5, 0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x01, 1 };
+			minBin.insert(minBin.end(),minBody,minBody+sizeof(minBody));
+			poco_assert(DecodeBinaryText(reinterpret_cast<const char*>(&minBin[0]),minBin.size()) == "-922337203685477580.8");
+		}
+
+		//appending is the same output as the stream operator
+		{
+			Value appendVal = lexical_cast<Value>(string("[\"OBJ\",\"1\",[1.5,[2,3]],true,any]"));
+			string appended = "[";
+			AppendValue(appendVal,appended);
+			poco_assert(appended == "[" + lexical_cast<string>(appendVal));
+		}
+
+		//number formats, compatible has to stay exactly what karma writes
+		{
+			const double samples[] = { 0, 5, -5, 1.5, 0.001, 0.0005, 1234.5678, -33.25, 99999.9996, 1e5, 1e-7, 123456789012.0, 0.1+0.2 };
+			const char* shortest[] = { "0", "5", "-5", "1.5", "0.001", "0.0005", "1234.5678", "-33.25", "99999.9996", "100000", "0.0000001", "123456789012", "0.30000000000000004" };
+			char numBuf[MAX_NUMBER_LEN];
+			for (size_t i=0;i<sizeof(samples)/sizeof(samples[0]);i++)
+			{
+				char* karmaEnd = outBuf;
+				karma::generate(karmaEnd,karma::double_,samples[i]);
+				poco_assert(string(numBuf,FormatDouble(samples[i],numBuf)) == string(outBuf,karmaEnd));
+
+				SetNumberFormat(NUMBERS_SHORTEST);
+				poco_assert(string(numBuf,FormatDouble(samples[i],numBuf)) == shortest[i]);
+				poco_assert(lexical_cast<string>(Value(samples[i])) == shortest[i]);
+				SetNumberFormat(NUMBERS_COMPATIBLE);
+			}
+			poco_assert(RoundDecimals(1234.5678,3) == 1234.568 && RoundDecimals(-0.00049,3) == 0 && RoundDecimals(2.5,-1) == 2.5);
+			poco_assert(RoundNumbers("[90.12345,[1234.5678,-5.55555,0.0001]]",2) == "[90.12,[1234.57,-5.56,0.0]]");
+			poco_assert(RoundNumbers("[1,",2) == "[1,");
+			Value rawRounded = MakeRaw("[1.23456,\"x\"]");
+			RoundNumbers(rawRounded,1);
+			poco_assert(lexical_cast<string>(rawRounded) == "[1.2,\"x\"]");
+		}
+
+		//typed arguments, straight from the document
+		{
+			Document argDoc;
+			string argStr = "5:[1,\"a\"]:\"77\":1.5:[\"x\",\"y\"]:any";
+			argDoc.parseParameters(argStr.c_str(),argStr.length());
+			DocArgs docArgs;
+			for (size_t arg=argDoc.first(argDoc.root());arg!=argDoc.next(argDoc.root());arg=argDoc.next(arg))
+				docArgs.push_back(arg);
+
+			string argError;
+			boost::tuple<Int64,ArrayText,int,double,vector<string>,boost::optional<Parameters>,boost::optional<bool>> decoded;
+			poco_assert(DecodeArgs(argDoc,docArgs,decoded,argError));
+			poco_assert(decoded.get<0>() == 5 && decoded.get<1>().text == "[1,\"a\"]" && decoded.get<2>() == 77 && decoded.get<3>() == 1.5);
+			poco_assert(decoded.get<4>().size() == 2 && decoded.get<4>()[1] == "y" && !decoded.get<5>() && !decoded.get<6>());
+
+			typedef boost::tuple<StringAny,double> NestedArgs;
+			boost::tuple<Ignored,Parameters,NestedArgs::inherited> nested;
+			poco_assert(DecodeArgs(argDoc,docArgs,nested,argError));
+			poco_assert(nested.get<1>().size() == 2 && nested.get<2>().get<0>().str == "77" && nested.get<2>().get<1>() == 1.5);
+
+			boost::tuple<int,Parameters,string,bool> wrongType;
+			poco_assert(!DecodeArgs(argDoc,docArgs,wrongType,argError) && argError == "param 3: expected bool, got number");
+			boost::tuple<Ignored,vector<int>> wrongElem;
+			poco_assert(!DecodeArgs(argDoc,docArgs,wrongElem,argError) && argError == "param 1[1]: expected int, got string");
+			docArgs.resize(1);
+			boost::tuple<int,double> missing;
+			poco_assert(!DecodeArgs(argDoc,docArgs,missing,argError) && argError == "param 1: expected number, got nothing");
+		}
+
+		//an object published without its ObjectID is replaced when the change feed (313) brings its row
+		{
+			ObjectStore store(100);
+			store.addPublished(0,555123,"UH1H_DZ",42,"[90,[1000,2000,0]]","[]","[]",0.5,0);
+			poco_assert(store.findByOwner(42).size() == 1);
+
+			const string row = "[\"OBJ\",\"77\",\"UH1H_DZ\",\"42\",[90,[1010,2000,0]],[],[],0.5,0]";
+			poco_assert(store.addStreamed(row.c_str(),row.length(),555123));
+			poco_assert(store.size() == 1 && store.findByOwner(42).size() == 1);
+			const Parameters found = boost::get<Parameters>(store.findByOwner(42)[0]);
+			poco_assert(GetStringAny(found[0]) == "77" && GetStringAny(found[1]) == "555123");
+
+			//both ids now lead to the same object
+			store.setMovement(77,"[90,[3000,2000,0]]",0.25);
+			store.setInventory(555123,true,"[[[\"ItemBandage\"],[1]],[[],[]],[[],[]]]");
+			poco_assert(store.findInRadius(1000,2000,50).empty() && store.findInRadius(3000,2000,1).size() == 1);
+			poco_assert(lexical_cast<string>(boost::get<Parameters>(store.findByOwner(42)[0])[5]) == "[[[\"ItemBandage\"],[1]],[[],[]],[[],[]]]");
+
+			//the same row again doesn't add anything either
+			poco_assert(store.addStreamed(row.c_str(),row.length(),555123) && store.findByOwner(42).size() == 1);
+			store.remove(555123,true);
+			poco_assert(store.size() == 0 && store.findByOwner(42).empty());
+		}
+
+		//objects the change feed (313) says were changed by something else get forgotten by the write filter,
+		//so putting back the value that was last written isn't skipped as unchanged
+		{
+			WriteFilter filter(Poco::Logger::get("HiveExt"),"object",2);
+			filter.written(77,0,"[[],[]]");
+			filter.written(77,1,"0.5");
+			filter.writtenPosition(77,1000,2000,0);
+			filter.written(78,0,"[[],[]]");
+			poco_assert(filter.isUnchanged(77,0,"[[],[]]") && filter.isUnchanged(77,1,"0.5") && filter.isNearby(77,1000,2000,0,1));
+
+			filter.forget(77);
+			poco_assert(!filter.isUnchanged(77,0,"[[],[]]") && !filter.isUnchanged(77,1,"0.5") && !filter.isNearby(77,1000,2000,0,1));
+			poco_assert(filter.isUnchanged(78,0,"[[],[]]"));
+		}
+
+		//grid edges: negative cells, points exactly on the radius and radiuses spanning more cells than are in use
+		{
+			ObjectStore store(100);
+			store.addPublished(1,0,"TentStorage",1,"[0,[-50,-50,0]]","[]","[]",0,0);
+			store.addPublished(2,0,"TentStorage",1,"[0,[50,-50,0]]","[]","[]",0,0);
+			store.addPublished(3,0,"TentStorage",1,"[0,[-50,50,0]]","[]","[]",0,0);
+			store.addPublished(4,0,"TentStorage",1,"[0,[300,400,0]]","[]","[]",0,0);
+			store.addPublished(5,0,"TentStorage",1,"[0,[99.5,0,0]]","[]","[]",0,0);
+			store.addPublished(6,0,"TentStorage",1,"[]","[]","[]",0,0);
+
+			poco_assert(store.findInRadius(-60,-60,20).size() == 1);
+			poco_assert(GetStringAny(boost::get<Parameters>(store.findInRadius(50,-50,1)[0])[0]) == "2");
+			poco_assert(GetStringAny(boost::get<Parameters>(store.findInRadius(-50,50,1)[0])[0]) == "3");
+			poco_assert(store.findInRadius(-150,-150,50).empty());
+
+			poco_assert(store.findInRadius(0,0,500).size() == 5);
+			poco_assert(store.findInRadius(0,0,499.9).size() == 4);
+			poco_assert(store.findInRadius(100.5,0,1).size() == 1 && store.findInRadius(100.5,0,0.9).empty());
+			poco_assert(store.findInRadius(297,396,5).size() == 1 && store.findInRadius(297,396,4.9).empty());
+
+			//goes through the cells in use instead, objects without a position are still left out
+			poco_assert(store.findInRadius(0,0,1000000).size() == 5);
+			poco_assert(store.findInRadius(-1000000,0,1000000).size() == 2);
+			poco_assert(store.findInRadius(0,0,-1).empty() && store.size() == 6);
+
+			//positions that aren't numbers or are far off any map are kept, but never found
+			store.addPublished(7,0,"TentStorage",1,"[0,[1e300,0,0]]","[]","[]",0,0);
+			store.addPublished(8,0,"TentStorage",1,"[0,[0,-1e30,0]]","[]","[]",0,0);
+			poco_assert(store.size() == 8 && store.findByOwner(1).size() == 8);
+			const double inf = std::numeric_limits<double>::infinity();
+			const double nan = std::numeric_limits<double>::quiet_NaN();
+			poco_assert(store.findInRadius(0,0,inf).size() == 5 && store.findInRadius(10000000,-10000000,1e300).size() == 5);
+			poco_assert(store.findInRadius(0,0,nan).empty() && store.findInRadius(nan,0,10).empty() && store.findInRadius(0,-inf,inf).empty());
+			poco_assert(store.findInRadius(1e300,0,1).empty() && store.findInRadius(0,-1e30,1).empty());
+		}
+
+		//a big result handed out in pieces (601) goes back together as it was
+		{
+			Parameters big;
+			for (int i=0;i<100;i++)
+			{
+				Parameters row;
+				row.push_back(string("OBJ"));
+				row.push_back(lexical_cast<string>(i));
+				row.push_back(string("UH1H_DZ"));
+				row.push_back(i*1000);
+				big.push_back(row);
+			}
+			const string full = lexical_cast<string>(Value(big));
+
+			const size_t budget = 64;
+			string joined;
+			size_t offset = 0, numPieces = 0;
+			while (offset < full.length())
+			{
+				const size_t before = offset;
+				RawValue slice = QuoteSlice(full,offset,budget);
+				poco_assert(offset > before && slice.text().length() <= budget+2);
+				poco_assert(slice.text()[0] == '"' && slice.text()[slice.text().length()-1] == '"');
+
+				//the way compile reads the string literal
+				const string& quoted = slice.text();
+				for (size_t i=1;i+1<quoted.length();i++)
+				{
+					joined += quoted[i];
+					if (quoted[i] == '"')
+						i++;
+				}
+				numPieces++;
+			}
+			poco_assert(numPieces > 1 && joined == full);
+			poco_assert(lexical_cast<Value>(joined) == Value(big));
+
+			//a quote that doesn't fit whole is left for the next piece
+			const string text = "ab\"c";
+			offset = 0;
+			poco_assert(QuoteSlice(text,offset,3).text() == "\"ab\"" && offset == 2);
+			poco_assert(QuoteSlice(text,offset,3).text() == "\"\"\"c\"" && offset == 4);
+			poco_assert(QuoteSlice(text,offset,3).text() == "\"\"" && offset == 4);
+		}
 	}
 };
\ No newline at end of file
@@ -23,7 +23,21 @@
 
 namespace Sqf
 {
-	typedef boost::make_recursive_variant< double, int, Int64, bool, string, void*, vector<boost::recursive_variant_> >::type Value;
+	//already serialized SQF that is only being passed along, gets written out verbatim
+	//the text is immutable and shared between copies
+	class RawValue
+	{
+	public:
+		explicit RawValue(string text) : _text(boost::make_shared<string>(std::move(text))) {}
+		explicit RawValue(shared_ptr<const string> text) : _text(std::move(text)) {}
+		const string& text() const { return *_text; }
+		const shared_ptr<const string>& shared() const { return _text; }
+		bool operator==(const RawValue& other) const { return _text == other._text || *_text == *other._text; }
+	private:
+		shared_ptr<const string> _text;
+	};
+
+	typedef boost::make_recursive_variant< double, int, Int64, bool, string, void*, vector<boost::recursive_variant_>, RawValue >::type Value;
 	typedef vector<Value> Parameters;
 
 	bool IsNull(const Value& val);
@@ -34,6 +48,117 @@ namespace Sqf
 	string GetStringAny(const Value& val);
 	bool GetBoolAny(const Value& val);
 
+	//direct buffer parsers, accepting exactly what the stream operators below accept
+	bool ParseValue(const char* str, size_t len, Value& out);
+	//text after the last colon isn't a parameter and is ignored, the same as lexical_cast<Parameters> does
+	void ParseParameters(const char* str, size_t len, Parameters& out);
+	//serializes straight into a fixed buffer (null terminated), false if it doesn't fit
+	bool WriteValue(const Value& val, char* out, size_t outSize, size_t& outLen);
+	//same output, appended to a string
+	void AppendValue(const Value& val, string& out);
+	//for stored SQF that doesn't need looking into, text that checks out is kept as a RawValue,
+	//anything else goes through the regular (more lenient) parser and may throw bad_lexical_cast
+	Value MakeRaw(string text);
+	//as much of text from offset as fits in budget chars, as a SQF string literal (quotes doubled, the enclosing ones not counted)
+	//offset moves past what was taken, used to hand out big results in pieces
+	RawValue QuoteSlice(const string& text, size_t& offset, size_t budget);
+
+	//how numbers are written by the generators and WriteValue
+	//compatible is the original output (at most 3 decimals, scientific outside of 0.001 to 100000)
+	//shortest is the shortest text that reads back as exactly the same double
+	enum NumberFormat
+	{
+		NUMBERS_COMPATIBLE,
+		NUMBERS_SHORTEST
+	};
+	//meant to be set once on startup, before anything gets generated
+	void SetNumberFormat(NumberFormat fmt);
+	NumberFormat GetNumberFormat();
+	const size_t MAX_NUMBER_LEN = 32;
+	//out must have room for MAX_NUMBER_LEN chars, returns the length written (not null terminated)
+	size_t FormatDouble(double val, char* out);
+	//val == mantissa / 10^scale exactly, with the smallest scale (up to 15) that does it
+	bool SplitDecimal(double val, Int64& mantissa, int& scale);
+	//nearest double with at most that many decimals, negative decimals leave it as it is
+	double RoundDecimals(double val, int decimals);
+	//rounds every number inside the value (raw values get parsed for it)
+	void RoundNumbers(Value& val, int decimals);
+	//same for serialized SQF, text that doesn't parse is returned as is
+	string RoundNumbers(const string& sqfText, int decimals);
+
+	//compact storage encoding (versioned, length prefixed, strings interned, optionally zlib compressed)
+	//used for database columns as an alternative to SQF text, layout is described in SqfBinary.cpp
+	bool IsBinary(const char* data, size_t len);
+	ByteVector EncodeBinary(const Value& val, bool compress);
+	//both of these throw bad_lexical_cast if the data isn't a valid encoding
+	Value DecodeBinary(const char* data, size_t len);
+	//SQF text of the encoded value, decimals are written the way they were stored
+	string DecodeBinaryText(const char* data, size_t len);
+
+	//flat read-only alternative to Value, meant for request parameters that are only looked at or passed on
+	//nodes are kept in document order on a single tape that gets reused between parses,
+	//an array node is directly followed by its elements and knows where its last element ends.
+	//string nodes point into the parsed buffer, so that must outlive the document's use
+	class Document
+	{
+	public:
+		enum NodeType
+		{
+			TYPE_DOUBLE,
+			TYPE_INT,
+			TYPE_BIGINT,
+			TYPE_BOOL,
+			TYPE_STRING,
+			TYPE_ANY,
+			TYPE_ARRAY
+		};
+		struct Node
+		{
+			NodeType type;
+			size_t len; //string length or number of elements
+			size_t end; //index of the node that follows this one (and its elements)
+			union
+			{
+				double dblVal;
+				Int64 intVal;
+				const char* strVal;
+			};
+		};
+
+		//root becomes an array of the parameters, never fails just like ParseParameters
+		void parseParameters(const char* str, size_t len);
+		//root becomes the value itself
+		bool parseValue(const char* str, size_t len);
+		void clear() { _nodes.clear(); }
+		bool empty() const { return _nodes.empty(); }
+
+		size_t root() const { return 0; }
+		NodeType type(size_t node) const { return at(node).type; }
+		size_t size(size_t node) const;
+		size_t child(size_t node, size_t idx) const;
+		//element iteration: for (size_t e=doc.first(arr);e!=doc.next(arr);e=doc.next(e))
+		size_t first(size_t node) const { return node+1; }
+		size_t next(size_t node) const { return at(node).end; }
+
+		//same semantics as the Value functions above
+		bool isNull(size_t node) const;
+		bool isAny(size_t node) const;
+		double getDouble(size_t node) const;
+		int getIntAny(size_t node) const;
+		Int64 getBigInt(size_t node) const;
+		string getStringAny(size_t node) const;
+		bool getBoolAny(size_t node) const;
+
+		Value toValue(size_t node) const;
+		//same output as the Value/Parameters generators (the latter doesn't quote strings)
+		void write(size_t node, string& out, bool quoteStrings = true) const;
+		string toString(size_t node) const { string out; write(node,out); return out; }
+	private:
+		const Node& at(size_t node) const;
+
+		vector<Node> _nodes;
+	};
+
 	void runTest();
 }
 
@@ -0,0 +1,225 @@
+/*
+* Copyright (C) 2009-2013 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "SqfArgs.h"
+
+#include <boost/spirit/include/qi.hpp>
+
+namespace
+{
+	const char* NodeTypeName(Sqf::Document::NodeType type)
+	{
+		switch (type)
+		{
+		case Sqf::Document::TYPE_DOUBLE: return "number";
+		case Sqf::Document::TYPE_INT: return "int";
+		case Sqf::Document::TYPE_BIGINT: return "bigint";
+		case Sqf::Document::TYPE_BOOL: return "bool";
+		case Sqf::Document::TYPE_STRING: return "string";
+		case Sqf::Document::TYPE_ANY: return "any";
+		case Sqf::Document::TYPE_ARRAY: return "array";
+		default: return "unknown";
+		}
+	}
+
+	//whole string has to be the number, like lexical_cast
+	template<typename T, typename Parser>
+	bool ParseWhole(const char* str, size_t len, const Parser& parser, T& out)
+	{
+		const char* end = str+len;
+		return boost::spirit::qi::parse(str,end,parser,out) && str == end;
+	}
+
+	bool Present(const Sqf::Document& doc, size_t node, const char* expected, string& error)
+	{
+		if (node != Sqf::MISSING_ARG)
+			return true;
+
+		error = Sqf::ArgTypeError(doc,node,expected);
+		return false;
+	}
+};
+
+namespace Sqf
+{
+	string ArgTypeError(const Document& doc, size_t node, const char* expected)
+	{
+		string error = ": expected ";
+		error += expected;
+		error += ", got ";
+		if (node == MISSING_ARG)
+			error += "nothing";
+		else
+			error += NodeTypeName(doc.type(node));
+
+		return error;
+	}
+
+	//the conversions below match the Get functions for the types a Document can hold
+
+	bool DecodeArg(const Document& doc, size_t node, int& out, string& error)
+	{
+		if (!Present(doc,node,"int",error))
+			return false;
+
+		Document::NodeType type = doc.type(node);
+		if (type == Document::TYPE_INT)
+		{
+			out = doc.getIntAny(node);
+			return true;
+		}
+		else if (type == Document::TYPE_STRING)
+		{
+			string str = doc.getStringAny(node);
+			if (ParseWhole(str.c_str(),str.length(),boost::spirit::qi::int_,out))
+				return true;
+		}
+
+		error = ArgTypeError(doc,node,"int");
+		return false;
+	}
+
+	bool DecodeArg(const Document& doc, size_t node, Int64& out, string& error)
+	{
+		if (!Present(doc,node,"integer",error))
+			return false;
+
+		Document::NodeType type = doc.type(node);
+		if (type == Document::TYPE_INT || type == Document::TYPE_BIGINT)
+		{
+			out = doc.getBigInt(node);
+			return true;
+		}
+		else if (type == Document::TYPE_DOUBLE)
+		{
+			double dblVal = doc.getDouble(node);
+			out = static_cast<Int64>(dblVal);
+			if (out == dblVal)
+				return true;
+		}
+		else if (type == Document::TYPE_STRING)
+		{
+			string str = doc.getStringAny(node);
+			if (ParseWhole(str.c_str(),str.length(),boost::spirit::qi::long_long,out))
+				return true;
+		}
+
+		error = ArgTypeError(doc,node,"integer");
+		return false;
+	}
+
+	bool DecodeArg(const Document& doc, size_t node, double& out, string& error)
+	{
+		if (!Present(doc,node,"number",error))
+			return false;
+
+		Document::NodeType type = doc.type(node);
+		if (type == Document::TYPE_DOUBLE || type == Document::TYPE_INT)
+		{
+			out = doc.getDouble(node);
+			return true;
+		}
+
+		error = ArgTypeError(doc,node,"number");
+		return false;
+	}
+
+	bool DecodeArg(const Document& doc, size_t node, bool& out, string& error)
+	{
+		if (!Present(doc,node,"bool",error))
+			return false;
+
+		if (doc.type(node) == Document::TYPE_BOOL)
+		{
+			out = doc.getBoolAny(node);
+			return true;
+		}
+
+		error = ArgTypeError(doc,node,"bool");
+		return false;
+	}
+
+	bool DecodeArg(const Document& doc, size_t node, string& out, string& error)
+	{
+		if (!Present(doc,node,"string",error))
+			return false;
+
+		if (doc.type(node) == Document::TYPE_STRING)
+		{
+			out = doc.getStringAny(node);
+			return true;
+		}
+
+		error = ArgTypeError(doc,node,"string");
+		return false;
+	}
+
+	bool DecodeArg(const Document& doc, size_t node, StringAny& out, string& error)
+	{
+		if (!Present(doc,node,"string",error))
+			return false;
+
+		out.str = doc.getStringAny(node);
+		return true;
+	}
+
+	bool DecodeArg(const Document& doc, size_t node, Value& out, string& error)
+	{
+		if (!Present(doc,node,"value",error))
+			return false;
+
+		out = doc.toValue(node);
+		return true;
+	}
+
+	bool DecodeArg(const Document& doc, size_t node, ArrayText& out, string& error)
+	{
+		if (!Present(doc,node,"array",error))
+			return false;
+
+		if (doc.type(node) == Document::TYPE_ARRAY)
+		{
+			out.text.clear();
+			doc.write(node,out.text);
+			return true;
+		}
+
+		error = ArgTypeError(doc,node,"array");
+		return false;
+	}
+
+	bool DecodeArg(const Document& doc, size_t node, ArrayNode& out, string& error)
+	{
+		if (!Present(doc,node,"array",error))
+			return false;
+
+		if (doc.type(node) == Document::TYPE_ARRAY)
+		{
+			out.node = node;
+			return true;
+		}
+
+		error = ArgTypeError(doc,node,"array");
+		return false;
+	}
+
+	bool DecodeArg(const Document& doc, size_t node, Ignored& out, string& error)
+	{
+		return Present(doc,node,"value",error);
+	}
+};
@@ -0,0 +1,165 @@
+/*
+* Copyright (C) 2009-2013 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "Sqf.h"
+#include <boost/optional.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/tuple/tuple.hpp>
+
+//Typed method arguments, decoded straight from a parsed request without throwing.
+//A method signature is a boost::tuple of argument types, for example
+//  boost::tuple<Int64, boost::optional<Sqf::Parameters>, double>
+//DecodeArgs fills it in order and describes the first argument that didn't fit.
+//Tuples hold at most 10 elements, a tuple's cons list (SomeTuple::inherited) used as an element
+//is decoded from the following arguments as if its elements were listed there directly.
+//
+//Accepted argument types, with the same conversion rules as the Sqf::Get functions:
+//  int (GetIntAny), Int64 (GetBigInt), double (GetDouble), bool and string (exact type only),
+//  StringAny (GetStringAny), Value (anything), ArrayText (array, serialized),
+//  ArrayNode (array, left in the document), Ignored (anything, not looked at), vector<T> (array of T),
+//  boost::optional<T> (T, or none if missing, empty string or any)
+namespace Sqf
+{
+	//indices of argument nodes in a Document
+	typedef vector<size_t> DocArgs;
+
+	struct StringAny
+	{
+		string str;
+	};
+	//array that only gets stored, so it's kept as text
+	struct ArrayText
+	{
+		string text;
+	};
+	struct Ignored {};
+	//array that's looked into by the handler itself, by node index into the document
+	struct ArrayNode
+	{
+		size_t node;
+	};
+
+	//node index of an argument that wasn't passed
+	const size_t MISSING_ARG = static_cast<size_t>(-1);
+
+	//each of these returns false if the node can't be converted,
+	//error then gets what was expected and what was there
+	bool DecodeArg(const Document& doc, size_t node, int& out, string& error);
+	bool DecodeArg(const Document& doc, size_t node, Int64& out, string& error);
+	bool DecodeArg(const Document& doc, size_t node, double& out, string& error);
+	bool DecodeArg(const Document& doc, size_t node, bool& out, string& error);
+	bool DecodeArg(const Document& doc, size_t node, string& out, string& error);
+	bool DecodeArg(const Document& doc, size_t node, StringAny& out, string& error);
+	bool DecodeArg(const Document& doc, size_t node, Value& out, string& error);
+	bool DecodeArg(const Document& doc, size_t node, ArrayText& out, string& error);
+	bool DecodeArg(const Document& doc, size_t node, Ignored& out, string& error);
+	bool DecodeArg(const Document& doc, size_t node, ArrayNode& out, string& error);
+
+	//": expected <what>, got <node type>"
+	string ArgTypeError(const Document& doc, size_t node, const char* expected);
+
+	template<typename T>
+	bool DecodeArg(const Document& doc, size_t node, boost::optional<T>& out, string& error)
+	{
+		if (node == MISSING_ARG || doc.isNull(node) || doc.isAny(node))
+		{
+			out = boost::none;
+			return true;
+		}
+
+		T val;
+		if (!DecodeArg(doc,node,val,error))
+			return false;
+
+		out = std::move(val);
+		return true;
+	}
+
+	template<typename T>
+	bool DecodeArg(const Document& doc, size_t node, vector<T>& out, string& error)
+	{
+		if (node == MISSING_ARG || doc.type(node) != Document::TYPE_ARRAY)
+		{
+			error = ArgTypeError(doc,node,"array");
+			return false;
+		}
+
+		out.clear();
+		out.resize(doc.size(node));
+		size_t idx = 0;
+		for (size_t elem=doc.first(node);elem!=doc.next(node);elem=doc.next(elem),idx++)
+		{
+			if (!DecodeArg(doc,elem,out[idx],error))
+			{
+				error = "[" + boost::lexical_cast<string>(idx) + "]" + error;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	namespace Detail
+	{
+		inline bool DecodeList(const Document& doc, const DocArgs& args, size_t& idx, const boost::tuples::null_type&, string& error)
+		{
+			return true;
+		}
+
+		template<typename Head, typename Tail>
+		bool DecodeList(const Document& doc, const DocArgs& args, size_t& idx, boost::tuples::cons<Head,Tail>& list, string& error);
+
+		template<typename T>
+		bool DecodeElem(const Document& doc, const DocArgs& args, size_t& idx, T& out, string& error)
+		{
+			size_t node = (idx < args.size()) ? args[idx] : MISSING_ARG;
+			if (!DecodeArg(doc,node,out,error))
+			{
+				error = "param " + boost::lexical_cast<string>(idx) + error;
+				return false;
+			}
+			idx++;
+			return true;
+		}
+
+		//nested lists continue with the following arguments
+		template<typename Head, typename Tail>
+		bool DecodeElem(const Document& doc, const DocArgs& args, size_t& idx, boost::tuples::cons<Head,Tail>& nested, string& error)
+		{
+			return DecodeList(doc,args,idx,nested,error);
+		}
+
+		template<typename Head, typename Tail>
+		bool DecodeList(const Document& doc, const DocArgs& args, size_t& idx, boost::tuples::cons<Head,Tail>& list, string& error)
+		{
+			if (!DecodeElem(doc,args,idx,list.head,error))
+				return false;
+
+			return DecodeList(doc,args,idx,list.get_tail(),error);
+		}
+	};
+
+	//extra arguments past the signature are ignored, like they were with Parameters
+	template<typename Signature>
+	bool DecodeArgs(const Document& doc, const DocArgs& args, Signature& out, string& error)
+	{
+		size_t idx = 0;
+		return Detail::DecodeList(doc,args,idx,static_cast<typename Signature::inherited&>(out),error);
+	}
+};
@@ -0,0 +1,503 @@
+/*
+* Copyright (C) 2009-2013 Rajko Stojadinovic <http://github.com/rajkosto/hive>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "Sqf.h"
+
+#include <cstring>
+#include <sstream>
+#include <boost/lexical_cast.hpp>
+#include <boost/unordered_map.hpp>
+#include <Poco/DeflatingStream.h>
+#include <Poco/InflatingStream.h>
+
+using boost::lexical_cast;
+using boost::bad_lexical_cast;
+
+//Layout of an encoded value:
+//  header: 0x00 'B' version flags
+//  if flags has FLAG_ZLIB: varint size of the body, followed by the zlib stream of the body
+//  otherwise the body follows directly
+//body:
+//  varint number of strings, then each string as varint length + bytes (every distinct string is stored once)
+//  the value tree, each node is a tag byte followed by:
+//    TAG_ANY, TAG_FALSE, TAG_TRUE: nothing
+//    TAG_INT, TAG_BIGINT: zigzag varint
+//    TAG_DECIMAL: zigzag varint mantissa, byte scale (value is mantissa / 10^scale)
+//    TAG_DOUBLE: 8 bytes of the little endian IEEE double, for values that have no short decimal form
+//    TAG_STRING: varint index into the string table
+//    TAG_ARRAY: varint element count, followed by the elements
+//SQF text never starts with a zero byte, so both forms can live in the same column
+
+namespace
+{
+	enum BinaryTag
+	{
+		TAG_ANY,
+		TAG_FALSE,
+		TAG_TRUE,
+		TAG_INT,
+		TAG_BIGINT,
+		TAG_DECIMAL,
+		TAG_DOUBLE,
+		TAG_STRING,
+		TAG_ARRAY
+	};
+
+	const UInt8 BINARY_MAGIC = 'B';
+	const UInt8 BINARY_VERSION = 1;
+	const UInt8 FLAG_ZLIB = 0x01;
+	const size_t HEADER_SIZE = 4;
+
+	//bodies smaller than this aren't worth running through zlib
+	const size_t COMPRESS_THRESHOLD = 128;
+	//refuse to inflate anything larger than this, no column is anywhere near it
+	const UInt64 MAX_BODY_SIZE = 16*1024*1024;
+	const size_t MAX_DEPTH = 64;
+
+	const int MAX_SCALE = 15;
+	const double Pow10[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	UInt64 ZigZag(Int64 val) { return (static_cast<UInt64>(val) << 1) ^ static_cast<UInt64>(val >> 63); }
+	Int64 UnZigZag(UInt64 val) { return static_cast<Int64>(val >> 1) ^ -static_cast<Int64>(val & 1); }
+
+	void PutVarint(ByteVector& out, UInt64 val)
+	{
+		while (val >= 0x80)
+		{
+			out.push_back(static_cast<UInt8>(val | 0x80));
+			val >>= 7;
+		}
+		out.push_back(static_cast<UInt8>(val));
+	}
+
+	class BinaryEncoder : public boost::static_visitor<void>
+	{
+	public:
+		BinaryEncoder(ByteVector& nodes) : _nodes(nodes) {}
+
+		void operator()(double val)
+		{
+			//anything that came from SQF text (like 1234.567) is stored as that decimal
+			Int64 mantissa;
+			int scale;
+			if (Sqf::SplitDecimal(val,mantissa,scale) && (val != 0 || 1.0/val > 0)) //keeps negative zero exact
+			{
+				_nodes.push_back(TAG_DECIMAL);
+				PutVarint(_nodes,ZigZag(mantissa));
+				_nodes.push_back(static_cast<UInt8>(scale));
+			}
+			else
+			{
+				UInt64 bits;
+				memcpy(&bits,&val,sizeof(bits));
+				_nodes.push_back(TAG_DOUBLE);
+				for (int i=0; i<8; i++)
+					_nodes.push_back(static_cast<UInt8>(bits >> (i*8)));
+			}
+		}
+		void operator()(int val)
+		{
+			_nodes.push_back(TAG_INT);
+			PutVarint(_nodes,ZigZag(val));
+		}
+		void operator()(Int64 val)
+		{
+			_nodes.push_back(TAG_BIGINT);
+			PutVarint(_nodes,ZigZag(val));
+		}
+		void operator()(bool val) { _nodes.push_back(val ? TAG_TRUE : TAG_FALSE); }
+		void operator()(const string& val)
+		{
+			auto found = _stringIdx.find(val);
+			size_t idx;
+			if (found != _stringIdx.end())
+				idx = found->second;
+			else
+			{
+				idx = _strings.size();
+				_stringIdx.insert(std::make_pair(val,idx));
+				_strings.push_back(val);
+			}
+			_nodes.push_back(TAG_STRING);
+			PutVarint(_nodes,idx);
+		}
+		void operator()(void* val) { _nodes.push_back(TAG_ANY); }
+		void operator()(const Sqf::RawValue& raw)
+		{
+			Sqf::Value expanded;
+			if (!Sqf::ParseValue(raw.text().c_str(),raw.text().length(),expanded))
+				throw bad_lexical_cast();
+
+			boost::apply_visitor(*this,expanded);
+		}
+		void operator()(const Sqf::Parameters& arr)
+		{
+			_nodes.push_back(TAG_ARRAY);
+			PutVarint(_nodes,arr.size());
+			for (auto it=arr.begin();it!=arr.end();++it)
+				boost::apply_visitor(*this,*it);
+		}
+
+		void writeStrings(ByteVector& out) const
+		{
+			PutVarint(out,_strings.size());
+			for (auto it=_strings.begin();it!=_strings.end();++it)
+			{
+				PutVarint(out,it->length());
+				out.insert(out.end(),it->begin(),it->end());
+			}
+		}
+	private:
+		ByteVector& _nodes;
+		boost::unordered_map<string,size_t> _stringIdx;
+		vector<string> _strings;
+	};
+
+	class BinaryReader
+	{
+	public:
+		BinaryReader(const UInt8* data, size_t len) : _curr(data), _end(data+len) {}
+
+		bool atEnd() const { return _curr == _end; }
+		const UInt8* position() const { return _curr; }
+		UInt8 getByte()
+		{
+			if (_curr == _end)
+				throw bad_lexical_cast();
+
+			return *_curr++;
+		}
+		UInt64 getVarint()
+		{
+			UInt64 val = 0;
+			for (int shift=0; shift<64; shift+=7)
+			{
+				const UInt8 b = getByte();
+				val |= static_cast<UInt64>(b & 0x7F) << shift;
+				if ((b & 0x80) == 0)
+					return val;
+			}
+			throw bad_lexical_cast();
+		}
+		//a count of things that take at least a byte each, can't be more than what's left
+		size_t getCount()
+		{
+			const UInt64 count = getVarint();
+			if (count > static_cast<UInt64>(_end-_curr))
+				throw bad_lexical_cast();
+
+			return static_cast<size_t>(count);
+		}
+		const char* getBytes(size_t len)
+		{
+			if (len > static_cast<size_t>(_end-_curr))
+				throw bad_lexical_cast();
+
+			const char* bytes = reinterpret_cast<const char*>(_curr);
+			_curr += len;
+			return bytes;
+		}
+		double getRawDouble()
+		{
+			const UInt8* bytes = reinterpret_cast<const UInt8*>(getBytes(8));
+			UInt64 bits = 0;
+			for (int i=0; i<8; i++)
+				bits |= static_cast<UInt64>(bytes[i]) << (i*8);
+
+			double val;
+			memcpy(&val,&bits,sizeof(val));
+			return val;
+		}
+		void getDecimal(Int64& mantissa, UInt8& scale)
+		{
+			mantissa = UnZigZag(getVarint());
+			scale = getByte();
+			if (scale > MAX_SCALE)
+				throw bad_lexical_cast();
+		}
+	private:
+		const UInt8* _curr;
+		const UInt8* _end;
+	};
+
+	//validates the header and gets the (inflated if needed) body
+	ByteVector ReadBody(const char* data, size_t len)
+	{
+		if (!Sqf::IsBinary(data,len))
+			throw bad_lexical_cast();
+
+		const UInt8 flags = static_cast<UInt8>(data[3]);
+		if (flags & ~FLAG_ZLIB)
+			throw bad_lexical_cast();
+
+		const UInt8* payload = reinterpret_cast<const UInt8*>(data+HEADER_SIZE);
+		const size_t payloadLen = len-HEADER_SIZE;
+		if ((flags & FLAG_ZLIB) == 0)
+			return ByteVector(payload,payload+payloadLen);
+
+		BinaryReader sizeReader(payload,payloadLen);
+		const UInt64 bodySize = sizeReader.getVarint();
+		if (bodySize > MAX_BODY_SIZE)
+			throw bad_lexical_cast();
+
+		const char* deflated = reinterpret_cast<const char*>(sizeReader.position());
+		std::istringstream compressed(string(deflated,reinterpret_cast<const char*>(payload+payloadLen)));
+		Poco::InflatingInputStream inflater(compressed,Poco::InflatingStreamBuf::STREAM_ZLIB);
+		ByteVector body(static_cast<size_t>(bodySize));
+		if (body.size() > 0)
+		{
+			inflater.read(reinterpret_cast<char*>(&body[0]),body.size());
+			if (static_cast<size_t>(inflater.gcount()) != body.size())
+				throw bad_lexical_cast();
+		}
+		return body;
+	}
+
+	class BinaryDecoder
+	{
+	public:
+		BinaryDecoder(const ByteVector& body) : _reader(body.empty() ? nullptr : &body[0],body.size())
+		{
+			const size_t numStrings = _reader.getCount();
+			_strings.reserve(numStrings);
+			for (size_t i=0; i<numStrings; i++)
+			{
+				const size_t strLen = _reader.getCount();
+				const char* str = _reader.getBytes(strLen);
+				_strings.push_back(string(str,strLen));
+			}
+		}
+
+		Sqf::Value readValue(size_t depth = 0)
+		{
+			const UInt8 tag = _reader.getByte();
+			switch (tag)
+			{
+			case TAG_ANY:
+				return Sqf::Value((void*)nullptr);
+			case TAG_FALSE:
+				return Sqf::Value(false);
+			case TAG_TRUE:
+				return Sqf::Value(true);
+			case TAG_INT:
+				return Sqf::Value(static_cast<int>(UnZigZag(_reader.getVarint())));
+			case TAG_BIGINT:
+				return Sqf::Value(UnZigZag(_reader.getVarint()));
+			case TAG_DECIMAL:
+				{
+					Int64 mantissa;
+					UInt8 scale;
+					_reader.getDecimal(mantissa,scale);
+					return Sqf::Value(static_cast<double>(mantissa)/Pow10[scale]);
+				}
+			case TAG_DOUBLE:
+				return Sqf::Value(_reader.getRawDouble());
+			case TAG_STRING:
+				return Sqf::Value(getString());
+			case TAG_ARRAY:
+				{
+					if (depth >= MAX_DEPTH)
+						throw bad_lexical_cast();
+
+					const size_t count = _reader.getCount();
+					Sqf::Parameters arr;
+					arr.reserve(count);
+					for (size_t i=0; i<count; i++)
+						arr.push_back(readValue(depth+1));
+
+					return Sqf::Value(std::move(arr));
+				}
+			default:
+				throw bad_lexical_cast();
+			}
+		}
+
+		void readText(string& out, size_t depth = 0)
+		{
+			const UInt8 tag = _reader.getByte();
+			switch (tag)
+			{
+			case TAG_ANY:
+				out += "any";
+				break;
+			case TAG_FALSE:
+				out += "false";
+				break;
+			case TAG_TRUE:
+				out += "true";
+				break;
+			case TAG_INT:
+				out += lexical_cast<string>(static_cast<int>(UnZigZag(_reader.getVarint())));
+				break;
+			case TAG_BIGINT:
+				out += lexical_cast<string>(UnZigZag(_reader.getVarint()));
+				break;
+			case TAG_DECIMAL:
+				{
+					Int64 mantissa;
+					UInt8 scale;
+					_reader.getDecimal(mantissa,scale);
+					WriteDecimal(out,mantissa,scale);
+				}
+				break;
+			case TAG_DOUBLE:
+				out += lexical_cast<string>(Sqf::Value(_reader.getRawDouble()));
+				break;
+			case TAG_STRING:
+				out += '"';
+				out += getString();
+				out += '"';
+				break;
+			case TAG_ARRAY:
+				{
+					if (depth >= MAX_DEPTH)
+						throw bad_lexical_cast();
+
+					const size_t count = _reader.getCount();
+					out += '[';
+					for (size_t i=0; i<count; i++)
+					{
+						if (i > 0)
+							out += ',';
+						readText(out,depth+1);
+					}
+					out += ']';
+				}
+				break;
+			default:
+				throw bad_lexical_cast();
+			}
+		}
+
+		void finish()
+		{
+			if (!_reader.atEnd())
+				throw bad_lexical_cast();
+		}
+	private:
+		const string& getString()
+		{
+			const UInt64 idx = _reader.getVarint();
+			if (idx >= _strings.size())
+				throw bad_lexical_cast();
+
+			return _strings[static_cast<size_t>(idx)];
+		}
+
+		static void WriteDecimal(string& out, Int64 mantissa, UInt8 scale)
+		{
+			if (mantissa < 0)
+				out += '-';
+
+			//negating INT64_MIN overflows, its magnitude only fits unsigned
+			const UInt64 magnitude = (mantissa < 0) ? (0 - static_cast<UInt64>(mantissa)) : static_cast<UInt64>(mantissa);
+			string digits = lexical_cast<string>(magnitude);
+			//keep it a double when read back
+			if (scale == 0)
+			{
+				out += digits;
+				out += ".0";
+				return;
+			}
+			if (digits.length() <= scale)
+				digits.insert(0,scale+1-digits.length(),'0');
+
+			out.append(digits,0,digits.length()-scale);
+			out += '.';
+			out.append(digits,digits.length()-scale,string::npos);
+		}
+
+		BinaryReader _reader;
+		vector<string> _strings;
+	};
+};
+
+namespace Sqf
+{
+	bool IsBinary(const char* data, size_t len)
+	{
+		return (data != nullptr && len >= HEADER_SIZE && data[0] == 0 &&
+			static_cast<UInt8>(data[1]) == BINARY_MAGIC && static_cast<UInt8>(data[2]) == BINARY_VERSION);
+	}
+
+	ByteVector EncodeBinary(const Value& val, bool compress)
+	{
+		ByteVector nodes;
+		BinaryEncoder encoder(nodes);
+		boost::apply_visitor(encoder,val);
+
+		ByteVector body;
+		encoder.writeStrings(body);
+		body.insert(body.end(),nodes.begin(),nodes.end());
+
+		ByteVector out;
+		out.reserve(HEADER_SIZE+body.size());
+		out.push_back(0);
+		out.push_back(BINARY_MAGIC);
+		out.push_back(BINARY_VERSION);
+		out.push_back(0); //flags
+
+		if (compress && body.size() >= COMPRESS_THRESHOLD)
+		{
+			std::ostringstream compressed;
+			{
+				Poco::DeflatingOutputStream deflater(compressed,Poco::DeflatingStreamBuf::STREAM_ZLIB);
+				deflater.write(reinterpret_cast<const char*>(&body[0]),body.size());
+				deflater.close();
+			}
+			const string deflated = compressed.str();
+
+			ByteVector sizePrefix;
+			PutVarint(sizePrefix,body.size());
+			//only keep it if it actually saved space
+			if (sizePrefix.size()+deflated.length() < body.size())
+			{
+				out[3] = FLAG_ZLIB;
+				out.insert(out.end(),sizePrefix.begin(),sizePrefix.end());
+				out.insert(out.end(),deflated.begin(),deflated.end());
+				return out;
+			}
+		}
+
+		out.insert(out.end(),body.begin(),body.end());
+		return out;
+	}
+
+	Value DecodeBinary(const char* data, size_t len)
+	{
+		const ByteVector body = ReadBody(data,len);
+		BinaryDecoder decoder(body);
+		Value val = decoder.readValue();
+		decoder.finish();
+		return val;
+	}
+
+	string DecodeBinaryText(const char* data, size_t len)
+	{
+		const ByteVector body = ReadBody(data,len);
+		BinaryDecoder decoder(body);
+		string text;
+		decoder.readText(text);
+		decoder.finish();
+		return text;
+	}
+};